@@ -0,0 +1,112 @@
+// Decode a file through a coroutine: a producer thread feeds it in small chunks,
+// as if from a socket, while the consumer coroutine awaits decoded blocks on a
+// run_loop.
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+// Fire-and-forget coroutine; starts right away and frees itself when done.
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+
+detached
+consume(mpg123::stream_decoder& dec,
+        mpg123::run_loop& loop,
+        std::size_t& total,
+        std::size_t& blocks,
+        std::exception_ptr& failure)
+{
+    try {
+        for (;;) {
+            auto pcm = co_await dec.next_block();
+            if (pcm.empty())
+                break;
+            total += pcm.size();
+            ++blocks;
+        }
+    }
+    catch (...) {
+        failure = std::current_exception();
+    }
+    loop.stop();
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [CHUNK_BYTES]" << endl;
+        return -1;
+    }
+
+    try {
+        const std::size_t chunk = argc > 2 ? std::stoul(argv[2]) : 1500;
+
+        std::ifstream input{argv[1], std::ios::binary};
+        if (!input)
+            throw std::runtime_error{"could not open input"};
+
+        mpg123::handle h;
+        mpg123::run_loop loop;
+        mpg123::stream_decoder dec{h, loop};
+
+        std::size_t total = 0;
+        std::size_t blocks = 0;
+        std::exception_ptr failure;
+
+        auto start = std::chrono::steady_clock::now();
+        consume(dec, loop, total, blocks, failure);
+
+        std::jthread producer{[&] {
+            std::vector<char> buf(chunk);
+            try {
+                while (input.read(buf.data(), buf.size()) || input.gcount()) {
+                    dec.feed(std::as_bytes(std::span{buf.data(), std::size_t(input.gcount())}));
+                    std::this_thread::sleep_for(std::chrono::microseconds{100});
+                }
+            }
+            catch (std::exception& e) {
+                cerr << "Feed error: " << e.what() << endl;
+            }
+            dec.close();
+        }};
+
+        loop.run();
+        producer.join();
+        if (failure)
+            std::rethrow_exception(failure);
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        cout << argv[1] << ": " << blocks << " blocks, " << total << " bytes of PCM ("
+             << dec.get_format() << ") in " << elapsed.count() << " s" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
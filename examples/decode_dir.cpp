@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+namespace fs = std::filesystem;
+
+
+bool
+is_mp3(const fs::path& p)
+{
+    auto ext = p.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".mp3";
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " INPUT_DIR OUTPUT_DIR [--direct]" << endl;
+        return -1;
+    }
+
+    try {
+        const fs::path input_dir = argv[1];
+        const fs::path output_dir = argv[2];
+        mpg123::pcm_writer::options opts;
+        opts.direct = argc > 3 && std::string{argv[3]} == "--direct";
+
+        fs::create_directories(output_dir);
+
+        std::uint64_t total_bytes = 0;
+        double total_seconds = 0;
+        unsigned files = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto& entry : fs::directory_iterator{input_dir}) {
+            if (!entry.is_regular_file() || !is_mp3(entry.path()))
+                continue;
+            try {
+                auto h = mpg123::handle::from_file(entry.path());
+                auto fmt = h.get_format();
+                auto out_name = output_dir / entry.path().filename().replace_extension(".wav");
+                mpg123::pcm_writer writer{out_name, fmt, opts};
+                auto bytes = writer.write_all(h);
+                writer.close();
+                total_bytes += bytes;
+                total_seconds += double(bytes)
+                    / (fmt.rate * fmt.channels * mpg123::sample_size(fmt.encoding));
+                ++files;
+            }
+            catch (std::exception& e) {
+                cerr << entry.path() << ": " << e.what() << endl;
+            }
+        }
+        auto finish = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(finish - start).count();
+
+        cout << "Files: " << files << '\n'
+             << "PCM written: " << total_bytes / (1024.0 * 1024.0) << " MiB\n"
+             << "Audio: " << total_seconds << " s\n"
+             << "Elapsed: " << elapsed << " s\n";
+        if (elapsed > 0)
+            cout << "Throughput: " << total_bytes / (1024.0 * 1024.0) / elapsed << " MiB/s ("
+                 << total_seconds / elapsed << "x realtime)" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using clock_type = std::chrono::steady_clock;
+
+
+// The stream cut into separately allocated packets, as a network stack hands
+// them over.
+std::vector<std::unique_ptr<std::byte[]>>
+make_packets(const std::vector<std::byte>& data,
+             std::size_t packet_size,
+             std::vector<std::span<const std::byte>>& fragments)
+{
+    std::vector<std::unique_ptr<std::byte[]>> packets;
+    fragments.clear();
+    for (std::size_t pos = 0; pos < data.size(); pos += packet_size) {
+        std::size_t n = std::min(packet_size, data.size() - pos);
+        auto& p = packets.emplace_back(std::make_unique<std::byte[]>(n));
+        std::copy_n(data.data() + pos, n, p.get());
+        fragments.emplace_back(p.get(), n);
+    }
+    return packets;
+}
+
+
+struct timing {
+    double feed;  // seconds spent coalescing and feeding
+    double total; // including decoding
+};
+
+
+// Feed the packets in bursts, decoding whatever output is available after each.
+timing
+run(std::span<const std::span<const std::byte>> fragments,
+    std::size_t burst,
+    bool scatter)
+{
+    mpg123::handle h;
+    h.open_feed();
+    std::vector<std::byte> staging;
+    std::vector<std::byte> out(64 * 1024);
+
+    clock_type::duration feeding{};
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < fragments.size(); i += burst) {
+        auto chain = fragments.subspan(i, std::min(burst, fragments.size() - i));
+
+        auto t0 = clock_type::now();
+        if (scatter)
+            h.feed(chain);
+        else {
+            staging.clear();
+            for (auto frag : chain)
+                staging.insert(staging.end(), frag.begin(), frag.end());
+            h.feed(std::span<const std::byte>{staging});
+        }
+        feeding += clock_type::now() - t0;
+
+        for (;;) {
+            auto r = h.try_read(out.data(), out.size());
+            if (r)
+                continue;
+            if (r.error().code == MPG123_NEW_FORMAT)
+                continue;
+            if (r.error().code == MPG123_NEED_MORE || r.error().code == MPG123_DONE)
+                break;
+            throw r.error();
+        }
+    }
+    auto total = clock_type::now() - start;
+    return {
+        std::chrono::duration<double>(feeding).count(),
+        std::chrono::duration<double>(total).count()
+    };
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [BURST]" << endl;
+        return -1;
+    }
+
+    try {
+        std::ifstream input{argv[1], std::ios::binary};
+        input.exceptions(std::ios::badbit);
+        std::vector<char> raw{std::istreambuf_iterator<char>{input}, {}};
+        std::vector<std::byte> data(raw.size());
+        std::ranges::transform(raw, data.begin(), [](char c) { return std::byte(c); });
+
+        const std::size_t burst = argc > 2 ? std::stoul(argv[2]) : 32;
+        const std::size_t sizes[] = { 64, 188, 512, 1316, 1460, 4096 };
+
+        cout << "packet  coalesce feed  scatter feed  coalesce total  scatter total  (ms)\n";
+        for (auto size : sizes) {
+            std::vector<std::span<const std::byte>> fragments;
+            auto packets = make_packets(data, size, fragments);
+            auto coalesced = run(fragments, burst, false);
+            auto scattered = run(fragments, burst, true);
+            cout << std::fixed << std::setprecision(2)
+                 << std::setw(6) << size
+                 << std::setw(15) << coalesced.feed * 1000
+                 << std::setw(14) << scattered.feed * 1000
+                 << std::setw(16) << coalesced.total * 1000
+                 << std::setw(15) << scattered.total * 1000
+                 << '\n';
+        }
+        cout.flush();
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
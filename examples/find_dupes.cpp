@@ -0,0 +1,80 @@
+// Find MP3 files with the same decoded audio, regardless of tags or encoder
+// padding.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+namespace fs = std::filesystem;
+
+
+bool
+is_mp3(const fs::path& p)
+{
+    auto ext = p.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".mp3";
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " DIR [--sha256]" << endl;
+        return -1;
+    }
+
+    try {
+        mpg123::pcm_hash_options opts;
+        opts.sha256 = argc > 2 && std::string{argv[2]} == "--sha256";
+
+        std::vector<fs::path> files;
+        for (auto& entry : fs::recursive_directory_iterator{argv[1]})
+            if (entry.is_regular_file() && is_mp3(entry.path()))
+                files.push_back(entry.path());
+
+        auto start = std::chrono::steady_clock::now();
+        auto digests = mpg123::hash_files(files, opts);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::map<std::string, std::vector<std::size_t>> groups;
+        std::size_t failed = 0;
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (!digests[i]) {
+                ++failed;
+                continue;
+            }
+            auto key = opts.sha256 ? digests[i]->sha256_hex() : digests[i]->hex();
+            groups[key].push_back(i);
+        }
+
+        std::size_t dupes = 0;
+        for (auto& [key, indices] : groups) {
+            if (indices.size() < 2)
+                continue;
+            dupes += indices.size() - 1;
+            cout << key << " (" << digests[indices[0]]->samples << " samples)\n";
+            for (auto i : indices)
+                cout << "    " << files[i].string() << '\n';
+        }
+        cout << files.size() << " files hashed in " << elapsed.count() << " s; "
+             << dupes << " duplicates, " << failed << " unreadable" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
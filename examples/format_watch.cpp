@@ -0,0 +1,64 @@
+// Decode files through a pcm_stream and report every output format change. With
+// --force RATE, the output is fixed to RATE Hz, stereo, signed 16-bit, and no
+// change should ever be seen after the first format.
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+int main(int argc, char* argv[])
+{
+    int first = 1;
+    std::optional<mpg123::format> forced;
+    if (argc > 2 && std::string{argv[1]} == "--force") {
+        forced = mpg123::format{std::stol(argv[2]), MPG123_STEREO, MPG123_ENC_SIGNED_16};
+        first = 3;
+    }
+    if (first >= argc) {
+        cerr << "Usage: " << argv[0] << " [--force RATE] FILE.mp3..." << endl;
+        return -1;
+    }
+
+    int status = 0;
+    for (int i = first; i < argc; ++i) {
+        try {
+            mpg123::handle h;
+            mpg123::pcm_stream stream{h, {.buffer_size = 0, .forced = forced}};
+            h.open(argv[i]);
+
+            cout << argv[i] << ":\n";
+            std::uintmax_t bytes = 0;
+            for (bool done = false; !done;) {
+                auto ev = stream.next();
+                switch (ev.type) {
+                    case mpg123::pcm_event::kind::samples:
+                        bytes += ev.samples.size();
+                        break;
+                    case mpg123::pcm_event::kind::new_format:
+                        cout << "  at byte " << bytes << ": " << ev.fmt << '\n';
+                        break;
+                    default:
+                        done = true;
+                }
+            }
+            cout << "  " << bytes << " bytes, " << stream.format_changes()
+                 << " format changes, output buffer " << stream.buffer().size()
+                 << " bytes" << endl;
+        }
+        catch (std::exception& e) {
+            cerr << argv[i] << ": " << e.what() << endl;
+            status = -1;
+        }
+    }
+    return status;
+}
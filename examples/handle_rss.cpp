@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+// Resident set size of this process, from /proc/self/statm.
+std::size_t
+rss_bytes()
+{
+    std::ifstream statm{"/proc/self/statm"};
+    std::size_t total = 0;
+    std::size_t resident = 0;
+    statm >> total >> resident;
+    return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " lean|default [COUNT] [FILE.mp3]\n"
+             << "Creates COUNT feed-mode handles (10000 by default), optionally feeding\n"
+             << "each one the first 16 KiB of FILE.mp3 and decoding a frame." << endl;
+        return -1;
+    }
+
+    try {
+        const std::string_view mode = argv[1];
+        const auto profile = mode == "lean"
+            ? mpg123::memory_profile::lean()
+            : mpg123::memory_profile::defaults();
+        const std::size_t count = argc > 2 ? std::stoul(argv[2]) : 10000;
+
+        std::vector<char> input;
+        if (argc > 3) {
+            std::ifstream file{argv[3], std::ios::binary};
+            input.assign(std::istreambuf_iterator<char>{file}, {});
+            input.resize(std::min<std::size_t>(input.size(), 16 * 1024));
+        }
+
+        std::vector<mpg123::handle> handles;
+        handles.reserve(count);
+        const std::size_t before = rss_bytes();
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& h = handles.emplace_back(profile);
+            h.open_feed();
+            if (!input.empty()) {
+                h.feed(input.data(), input.size());
+                for (;;) {
+                    auto f = h.try_decode_frame();
+                    if (f || f.error().code != MPG123_NEW_FORMAT)
+                        break;
+                }
+            }
+        }
+        const std::size_t after = rss_bytes();
+
+        std::size_t estimate = 0;
+        for (auto& h : handles)
+            estimate += h.resident_bytes();
+
+        cout << count << " " << mode << " handles\n"
+             << "RSS growth:         " << (after - before) / 1024 << " KiB, "
+             << (after - before) / count << " bytes per handle\n"
+             << "resident_bytes():   " << estimate / 1024 << " KiB, "
+             << estimate / count << " bytes per handle" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using clock_type = std::chrono::steady_clock;
+
+
+// Open every file and parse its tags, so only the conversion to C++ objects is
+// timed.
+std::vector<mpg123::handle>
+open_batch(int argc,
+           char* argv[])
+{
+    std::vector<mpg123::handle> result;
+    for (int i = 1; i < argc; ++i) {
+        try {
+            mpg123::handle h;
+            h.add_flags(MPG123_PICTURE);
+            h.open(argv[i]);
+            h.get_format();
+            result.push_back(std::move(h));
+        }
+        catch (std::exception& e) {
+            cerr << argv[i] << ": " << e.what() << endl;
+        }
+    }
+    return result;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [FILE.mp3 ...]" << endl;
+        return -1;
+    }
+
+    try {
+        const int rounds = 20;
+        clock_type::duration global{};
+        clock_type::duration monotonic{};
+        std::size_t tags = 0;
+
+        for (int r = 0; r < rounds; ++r) {
+            {
+                auto batch = open_batch(argc, argv);
+                std::vector<mpg123::id3> results;
+                results.reserve(batch.size());
+                auto start = clock_type::now();
+                for (auto& h : batch)
+                    if (auto t = h.try_get_id3())
+                        results.push_back(std::move(*t));
+                tags += results.size();
+                results.clear();
+                global += clock_type::now() - start;
+            }
+            {
+                auto batch = open_batch(argc, argv);
+                std::pmr::monotonic_buffer_resource arena{64 * 1024};
+                std::pmr::vector<mpg123::pmr::id3> results{&arena};
+                results.reserve(batch.size());
+                auto start = clock_type::now();
+                for (auto& h : batch)
+                    if (auto t = h.try_get_id3(&arena))
+                        results.push_back(std::move(*t));
+                results.clear();
+                arena.release();
+                monotonic += clock_type::now() - start;
+            }
+        }
+
+        using ms = std::chrono::duration<double, std::milli>;
+        cout << "Tags per round: " << tags / rounds << '\n'
+             << "Global allocator: " << ms(global).count() / rounds << " ms per batch\n"
+             << "Monotonic arena:  " << ms(monotonic).count() / rounds << " ms per batch" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,66 @@
+// Measure the loudness of an album: EBU R128 values and ReplayGain 2.0 gains for
+// each track and for the whole album, with one file per core.
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+void
+print(const std::string& name,
+      const mpg123::loudness& l)
+{
+    cout << std::setw(8) << l.integrated << " LUFS"
+         << std::setw(7) << l.range << " LU"
+         << std::setw(8) << l.true_peak_db() << " dBTP"
+         << std::setw(8) << l.replaygain() << " dB"
+         << "  " << name << '\n';
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " [-jTHREADS] FILE.mp3..." << endl;
+        return -1;
+    }
+
+    try {
+        unsigned threads = 0;
+        std::vector<mpg123::path> files;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.starts_with("-j"))
+                threads = std::stoul(arg.substr(2));
+            else
+                files.emplace_back(arg);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = mpg123::analyze_album(files, threads);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        cout << std::fixed << std::setprecision(2)
+             << "  integrated  range   true peak   track gain\n";
+        for (std::size_t i = 0; i < files.size(); ++i)
+            print(files[i].filename().string(), result.tracks[i]);
+        print("(album)", result.album);
+        cout << files.size() << " files in " << elapsed.count() << " s, using "
+             << (threads ? threads : std::thread::hardware_concurrency()) << " threads" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
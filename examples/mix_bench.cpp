@@ -0,0 +1,63 @@
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+// Time how long one core takes to decode and mix n copies of the input files.
+double
+realtime_load(unsigned n,
+              int num_files,
+              char* files[],
+              unsigned blocks)
+{
+    mpg123::mixer m;
+    for (unsigned i = 0; i < n; ++i) {
+        auto id = m.add_file(files[i % num_files], 1.0f / n);
+        // Keep some fades going, like a real playout would.
+        if (i % 2)
+            m.fade(id, 0.0f, m.get_options().block_frames * blocks);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b)
+        m.mix();
+    auto finish = std::chrono::steady_clock::now();
+
+    double elapsed = std::chrono::duration<double>(finish - start).count();
+    double audio = double(blocks * m.get_options().block_frames) / m.get_options().rate;
+    return elapsed / audio;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [FILE.mp3 ...]" << endl;
+        return -1;
+    }
+
+    try {
+        const unsigned blocks = 200; // about 4 s of audio
+        unsigned best = 0;
+        for (unsigned n = 1; n <= 4096; n *= 2) {
+            double load = realtime_load(n, argc - 1, argv + 1, blocks);
+            cout << n << " streams: " << load * 100 << "% of one core" << endl;
+            if (load > 1)
+                break;
+            best = n;
+        }
+        cout << "At least " << best << " streams can be mixed in real time on one core."
+             << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
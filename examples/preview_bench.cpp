@@ -0,0 +1,53 @@
+// Compare full decoding with preview decoding (quarter rate, mono, 8-bit, one
+// frame in N) on each file.
+
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+int main(int argc, char* argv[])
+{
+    int first = 1;
+    mpg123::preview_options opts;
+    if (argc > 2 && std::string{argv[1]} == "--step") {
+        opts.frame_step = std::stoul(argv[2]);
+        first = 3;
+    }
+    if (first >= argc) {
+        cerr << "Usage: " << argv[0] << " [--step N] FILE.mp3..." << endl;
+        return -1;
+    }
+
+    int status = 0;
+    double full = 0;
+    double preview = 0;
+    for (int i = first; i < argc; ++i) {
+        try {
+            auto r = mpg123::measure_preview(argv[i], opts);
+            full += r.full_seconds;
+            preview += r.preview_seconds;
+            cout << argv[i] << ": " << std::fixed << std::setprecision(3)
+                 << r.full_seconds * 1000 << " ms full, "
+                 << r.preview_seconds * 1000 << " ms preview ("
+                 << r.frames_decoded << "/" << r.frames << " frames decoded), "
+                 << std::setprecision(1) << r.speedup() << "x" << endl;
+        }
+        catch (std::exception& e) {
+            cerr << argv[i] << ": " << e.what() << endl;
+            status = -1;
+        }
+    }
+    if (preview > 0)
+        cout << "Overall: " << std::fixed << std::setprecision(1)
+             << full / preview << "x faster" << endl;
+    return status;
+}
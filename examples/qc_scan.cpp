@@ -0,0 +1,115 @@
+// Validate uploads by parsing frame headers only, and optionally compare the
+// time against a full decode.
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using clock_type = std::chrono::steady_clock;
+using ms = std::chrono::duration<double, std::milli>;
+
+
+void
+report(const std::string& name,
+       const mpg123::frame_stats& st)
+{
+    static const char* const versions[] = { "1", "2", "2.5" };
+    static const char* const modes[] = { "stereo", "joint", "dual", "mono" };
+
+    cout << name << (st.is_clean() ? ": ok\n" : ": PROBLEMS\n")
+         << "  " << st.frames << " frames, " << st.duration << " s, "
+         << st.average_bitrate() << " kbit/s "
+         << (st.is_vbr() ? "VBR" : "CBR") << '\n';
+    cout << "  MPEG";
+    for (unsigned v = 0; v < st.versions.size(); ++v)
+        if (st.versions[v])
+            cout << ' ' << versions[v] << " (" << st.versions[v] << ')';
+    cout << ", layer";
+    for (unsigned l = 1; l < st.layers.size(); ++l)
+        if (st.layers[l])
+            cout << ' ' << l << " (" << st.layers[l] << ')';
+    cout << ", mode";
+    for (unsigned m = 0; m < st.modes.size(); ++m)
+        if (st.modes[m])
+            cout << ' ' << modes[m] << " (" << st.modes[m] << ')';
+    cout << '\n';
+    cout << "  bitrates:";
+    for (auto [kbps, count] : st.bitrates)
+        cout << ' ' << kbps << ':' << count;
+    cout << '\n';
+    if (st.resyncs)
+        cout << "  lost sync " << st.resyncs << " times, skipping "
+             << st.skipped_bytes << " bytes\n";
+    if (st.format_changes)
+        cout << "  format changed " << st.format_changes << " times\n";
+    if (st.failure)
+        cout << "  stopped: " << st.failure->what() << '\n';
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " [--decode] FILE.mp3..." << endl;
+        return -1;
+    }
+
+    bool decode = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--decode")
+            decode = true;
+        else
+            files.push_back(arg);
+    }
+
+    int status = 0;
+    double scan_ms = 0;
+    double decode_ms = 0;
+    cout << std::fixed << std::setprecision(1);
+    for (auto& name : files) {
+        try {
+            auto start = clock_type::now();
+            auto st = mpg123::scan_frames(name);
+            scan_ms += ms{clock_type::now() - start}.count();
+            report(name, st);
+            if (!st.is_clean())
+                status = 1;
+
+            if (decode) {
+                start = clock_type::now();
+                auto h = mpg123::handle::from_file(name);
+                for (;;) {
+                    auto f = h.try_decode_frame();
+                    if (!f && f.error().code == MPG123_DONE)
+                        break;
+                    if (!f && f.error().code != MPG123_NEW_FORMAT)
+                        throw f.error();
+                }
+                decode_ms += ms{clock_type::now() - start}.count();
+            }
+        }
+        catch (std::exception& e) {
+            cerr << name << ": " << e.what() << endl;
+            status = -1;
+        }
+    }
+
+    cout << "Header scan: " << scan_ms << " ms\n";
+    if (decode)
+        cout << "Full decode: " << decode_ms << " ms ("
+             << decode_ms / scan_ms << "x the scan)\n";
+    cout << std::flush;
+    return status;
+}
@@ -0,0 +1,123 @@
+// Decode many streams arriving over sockets from a single thread. Local
+// socketpairs stand in for remote sources; one consumer is deliberately slow, to
+// show the backpressure.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+struct stream_state {
+    mpg123::handle h;
+    std::size_t pcm_bytes = 0;
+    bool failed = false;
+};
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [STREAMS]" << endl;
+        return -1;
+    }
+
+    try {
+        std::ifstream input{argv[1], std::ios::binary};
+        const std::vector<char> data{std::istreambuf_iterator<char>{input}, {}};
+        const std::size_t count = argc > 2 ? std::stoul(argv[2]) : 200;
+
+        mpg123::epoll_multiplexer mux;
+        std::vector<stream_state> streams(count);
+        std::vector<std::jthread> senders;
+
+        // The slow consumer takes up to this many bytes per resume().
+        std::size_t slow_budget = 0;
+        int slow_id = -1;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+                throw std::system_error{errno, std::generic_category(), "socketpair()"};
+
+            auto& st = streams[i];
+            const bool slow = i == 0;
+            int id = mux.add(sv[0],
+                             st.h,
+                             [&st, slow, &slow_budget](mpg123::handle&,
+                                                       std::span<const std::byte> pcm)
+                             -> std::size_t
+                             {
+                                 std::size_t taken = pcm.size();
+                                 if (slow) {
+                                     taken = std::min(taken, slow_budget);
+                                     slow_budget -= taken;
+                                 }
+                                 st.pcm_bytes += taken;
+                                 return taken;
+                             },
+                             [&st, fd = sv[0]](mpg123::handle&, std::exception_ptr error)
+                             {
+                                 st.failed = bool(error);
+                                 ::close(fd);
+                             });
+            if (slow)
+                slow_id = id;
+
+            // Send the file in packet-sized writes, like a relay would.
+            senders.emplace_back([fd = sv[1], &data]
+            {
+                std::size_t pos = 0;
+                while (pos < data.size()) {
+                    auto n = ::write(fd, data.data() + pos, std::min<std::size_t>(1400, data.size() - pos));
+                    if (n <= 0)
+                        break;
+                    pos += n;
+                }
+                ::close(fd);
+            });
+        }
+
+        std::size_t max_paused = 0;
+        while (mux.run_once(5)) {
+            max_paused = std::max(max_paused, mux.paused());
+            slow_budget += 64 * 1024;
+            mux.resume(slow_id);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::size_t total = 0;
+        std::size_t failed = 0;
+        for (auto& st : streams) {
+            total += st.pcm_bytes;
+            failed += st.failed;
+        }
+        cout << count << " streams in " << elapsed.count() << " s on one thread\n"
+             << "PCM decoded: " << total / (1024 * 1024) << " MiB\n"
+             << "Failed streams: " << failed << '\n'
+             << "Most streams paused at once: " << max_paused << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
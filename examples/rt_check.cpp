@@ -0,0 +1,266 @@
+// Check that the real-time-safe subset of handle (see handle.hpp) doesn't
+// allocate once decoding is warmed up. Every allocation made by the decoding
+// thread after the warm-up is counted, including libmpg123's own; exits with an
+// error if there were any.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+namespace {
+
+    struct alloc_stats {
+        std::size_t count;
+        std::size_t bytes;
+    };
+
+    // Only the thread that armed the guard is watched.
+    thread_local constinit bool armed = false;
+    thread_local constinit alloc_stats stats{};
+
+
+    void
+    note(std::size_t size)
+        noexcept
+    {
+        if (armed) {
+            ++stats.count;
+            stats.bytes += size;
+        }
+    }
+
+
+    void
+    arm()
+        noexcept
+    {
+        stats = {};
+        armed = true;
+    }
+
+
+    alloc_stats
+    disarm()
+        noexcept
+    {
+        armed = false;
+        return stats;
+    }
+
+} // namespace
+
+
+#ifdef __GLIBC__
+
+// Interpose the C allocator, so allocations inside libmpg123 are seen too;
+// operator new ends up here as well.
+
+extern "C" {
+
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t n, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void __libc_free(void* ptr);
+
+
+    void*
+    malloc(std::size_t size)
+    {
+        note(size);
+        return __libc_malloc(size);
+    }
+
+
+    void*
+    calloc(std::size_t n,
+           std::size_t size)
+    {
+        note(n * size);
+        return __libc_calloc(n, size);
+    }
+
+
+    void*
+    realloc(void* ptr,
+            std::size_t size)
+    {
+        note(size);
+        return __libc_realloc(ptr, size);
+    }
+
+
+    void*
+    aligned_alloc(std::size_t alignment,
+                  std::size_t size)
+    {
+        note(size);
+        return __libc_memalign(alignment, size);
+    }
+
+
+    void*
+    memalign(std::size_t alignment,
+             std::size_t size)
+    {
+        note(size);
+        return __libc_memalign(alignment, size);
+    }
+
+
+    int
+    posix_memalign(void** ptr,
+                   std::size_t alignment,
+                   std::size_t size)
+    {
+        note(size);
+        void* p = __libc_memalign(alignment, size);
+        if (!p)
+            return ENOMEM;
+        *ptr = p;
+        return 0;
+    }
+
+
+    void
+    free(void* ptr)
+    {
+        __libc_free(ptr);
+    }
+
+} // extern "C"
+
+#else
+
+// Elsewhere only C++ allocations can be seen.
+
+void*
+operator new(std::size_t size)
+{
+    note(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+
+void
+operator delete(void* ptr)
+    noexcept
+{
+    std::free(ptr);
+}
+
+
+void
+operator delete(void* ptr,
+                std::size_t)
+    noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+
+// Steady-state decoding through try_read().
+alloc_stats
+check_read(const char* filename,
+           int warmup)
+{
+    auto h = mpg123::handle::from_file(filename);
+    std::vector<std::byte> buf(64 * 1024);
+
+    for (int i = 0; i < warmup; ++i) {
+        auto r = h.try_read(buf.data(), buf.size());
+        if (!r && r.error().code != MPG123_NEW_FORMAT)
+            break;
+    }
+
+    arm();
+    for (;;) {
+        auto r = h.try_read(buf.data(), buf.size());
+        if (!r && r.error().code != MPG123_NEW_FORMAT)
+            break;
+    }
+    // The end of the stream is reported again; this is the error path.
+    (void)h.try_read(buf.data(), buf.size());
+    return disarm();
+}
+
+
+// Steady-state decoding through try_decode_frame(), with the synthesis-side
+// volume changed on every frame.
+alloc_stats
+check_decode_frame(const char* filename,
+                   int warmup)
+{
+    auto h = mpg123::handle::from_file(filename);
+
+    for (int i = 0; i < warmup; ++i) {
+        auto f = h.try_decode_frame();
+        if (!f && f.error().code != MPG123_NEW_FORMAT)
+            break;
+    }
+
+    arm();
+    double vol = 1.0;
+    for (;;) {
+        auto f = h.try_decode_frame();
+        if (!f && f.error().code != MPG123_NEW_FORMAT)
+            break;
+        vol = vol > 0.5 ? vol - 0.01 : 1.0;
+        (void)h.try_set_volume(vol);
+        (void)h.tell();
+    }
+    (void)h.try_decode_frame();
+    return disarm();
+}
+
+
+bool
+report(const char* name,
+       alloc_stats stats)
+{
+    cout << name << ": " << stats.count << " allocations, "
+         << stats.bytes << " bytes" << endl;
+    return stats.count == 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [WARMUP_FRAMES]" << endl;
+        return -1;
+    }
+
+    try {
+        const int warmup = argc > 2 ? std::stoi(argv[2]) : 4;
+        bool ok = true;
+        ok &= report("try_read", check_read(argv[1], warmup));
+        ok &= report("try_decode_frame", check_decode_frame(argv[1], warmup));
+        if (!ok) {
+            cerr << "FAIL: the decoding path allocated after warm-up" << endl;
+            return 1;
+        }
+        cout << "OK" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
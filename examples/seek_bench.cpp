@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using clock_type = std::chrono::steady_clock;
+using ms = std::chrono::duration<double, std::milli>;
+
+
+struct named_policy {
+    const char* name;
+    mpg123::seek_policy policy;
+};
+
+
+// Seek to each position and decode one frame, as an editor does when scrubbing.
+void
+bench(const char* filename,
+      const named_policy& p,
+      const std::vector<std::intmax_t>& positions)
+{
+    auto start = clock_type::now();
+    auto h = mpg123::handle::from_file(filename, p.policy);
+    auto opened = clock_type::now();
+
+    std::vector<double> latencies;
+    latencies.reserve(positions.size());
+    for (auto pos : positions) {
+        auto t0 = clock_type::now();
+        h.seek(pos);
+        for (;;) {
+            auto f = h.try_decode_frame();
+            if (f || f.error().code != MPG123_NEW_FORMAT)
+                break;
+        }
+        latencies.push_back(ms(clock_type::now() - t0).count());
+    }
+
+    std::ranges::sort(latencies);
+    double total = 0;
+    for (double l : latencies)
+        total += l;
+    auto index = h.get_seek_index();
+
+    cout << std::left << std::setw(12) << p.name << std::right << std::fixed
+         << std::setprecision(2)
+         << std::setw(10) << ms(opened - start).count()
+         << std::setw(10) << total / latencies.size()
+         << std::setw(10) << latencies[latencies.size() / 2]
+         << std::setw(10) << latencies.back()
+         << std::setw(10) << index.offsets.size()
+         << std::setw(6) << index.step
+         << std::setw(10) << index.memory() / 1024.0
+         << '\n';
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [SEEKS]" << endl;
+        return -1;
+    }
+
+    try {
+        const int seeks = argc > 2 ? std::stoi(argv[2]) : 200;
+
+        // Use the exact length, so every policy seeks to the same places.
+        auto probe = mpg123::handle::from_file(argv[1], mpg123::seek_policy::prescanned());
+        const auto length = probe.length();
+        probe.close();
+
+        std::mt19937_64 rng{42};
+        std::uniform_int_distribution<std::intmax_t> dist{0, std::max<std::intmax_t>(length - 1, 0)};
+        std::vector<std::intmax_t> positions(seeks);
+        for (auto& p : positions)
+            p = dist(rng);
+
+        const named_policy policies[] = {
+            { "default",    mpg123::seek_policy::defaults()    },
+            { "no index",   mpg123::seek_policy::fixed(0)      },
+            { "fixed 100",  mpg123::seek_policy::fixed(100)    },
+            { "growing",    mpg123::seek_policy::growing()     },
+            { "fuzzy",      mpg123::seek_policy::fuzzy_toc()   },
+            { "prescanned", mpg123::seek_policy::prescanned()  },
+        };
+
+        cout << length << " samples, " << seeks << " random seeks\n"
+             << "policy         open ms   mean ms    p50 ms    max ms   entries  step index KiB\n";
+        for (auto& p : policies)
+            bench(argv[1], p, positions);
+        cout.flush();
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
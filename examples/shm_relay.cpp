@@ -0,0 +1,69 @@
+// Pass decoded PCM between processes through a shared-memory ring.
+//
+//   shm_relay write /NAME FILE.mp3   decode FILE into the ring
+//   shm_relay read /NAME             attach and count what comes through
+//
+// Start the readers first; a reader only sees what's written after it attaches.
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+int main(int argc, char* argv[])
+{
+    const std::string mode = argc > 1 ? argv[1] : "";
+    if (argc < 3 || (mode == "write" && argc < 4) || (mode != "write" && mode != "read")) {
+        cerr << "Usage: " << argv[0] << " write /NAME FILE.mp3\n"
+             << "       " << argv[0] << " read /NAME" << endl;
+        return -1;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t bytes = 0;
+
+        if (mode == "write") {
+            auto ring = mpg123::shm_pcm_writer::create(argv[2], {});
+            auto h = mpg123::handle::from_file(argv[3]);
+            // Give the readers a moment to attach.
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+            cout << "Writing to " << argv[2] << " with " << ring.num_readers()
+                 << " reader(s)" << endl;
+            bytes = ring.write_all(h);
+        } else {
+            mpg123::shm_pcm_reader ring{argv[2]};
+            mpg123::format last{};
+            while (!ring.eof()) {
+                auto pcm = ring.wait_readable(std::chrono::milliseconds{500});
+                if (pcm.empty())
+                    continue;
+                if (ring.get_format() != last) {
+                    last = ring.get_format();
+                    cout << "Format: " << last << endl;
+                }
+                bytes += pcm.size();
+                ring.consume(pcm.size());
+            }
+            if (ring.dropped())
+                cout << "Dropped " << ring.dropped() << " bytes" << endl;
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        cout << bytes << " bytes in " << elapsed.count() << " s" << endl;
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,54 @@
+// Print where the sound starts and ends in each file, i.e. how much leading and
+// trailing silence could be trimmed.
+
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3..." << endl;
+        return -1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; ++i) {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            auto h = mpg123::handle::from_file(argv[i]);
+            const long rate = h.get_format().rate;
+            auto b = mpg123::find_silence_bounds(h);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            cout << argv[i] << ":\n" << std::fixed << std::setprecision(3);
+            if (!b.first_sound) {
+                cout << "  silent (" << double(b.length) / rate << " s)\n";
+            } else {
+                const auto lead = b.first_sound->sample;
+                const auto trail = b.length - b.last_sound->sample - 1;
+                cout << "  leading silence:  " << double(lead) / rate << " s"
+                     << " (sample " << lead
+                     << ", input byte " << b.first_sound->input_offset << ")\n"
+                     << "  trailing silence: " << double(trail) / rate << " s"
+                     << " (sample " << b.last_sound->sample
+                     << ", input byte " << b.last_sound->input_offset << ")\n";
+            }
+            cout << "  scanned in " << elapsed.count() << " ms" << endl;
+        }
+        catch (std::exception& e) {
+            cerr << argv[i] << ": " << e.what() << endl;
+            status = -1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,128 @@
+// Compare the cost and accuracy of the waveform modes: the precise overview on
+// one thread and on all cores, and the mono/down-sampled previews. Accuracy is
+// measured on the finest level, against the precise overview.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <mpg123xx/mpg123.hpp>
+
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using clock_type = std::chrono::steady_clock;
+using ms = std::chrono::duration<double, std::milli>;
+
+
+struct error_stats {
+    // Errors as fractions of full scale.
+    double peak_max = 0; // worst min/max error
+    double peak_mean = 0;
+    double rms_mean = 0;
+};
+
+
+error_stats
+compare(const mpg123::waveform& ref,
+        const mpg123::waveform& w)
+{
+    auto a = ref.level(0).buckets;
+    auto b = w.level(0).buckets;
+    const std::size_t n = std::min(a.size(), b.size());
+    error_stats st;
+    double peak_max = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dmin = std::abs(a[i].min - b[i].min) / 32767.0;
+        const double dmax = std::abs(a[i].max - b[i].max) / 32767.0;
+        peak_max = std::max({peak_max, dmin, dmax});
+        st.peak_mean += (dmin + dmax) / 2;
+        st.rms_mean += std::abs(a[i].rms - b[i].rms) / 32767.0;
+    }
+    if (n) {
+        st.peak_mean /= n;
+        st.rms_mean /= n;
+    }
+    st.peak_max = peak_max;
+    return st;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " FILE.mp3 [OUTPUT.wf]" << endl;
+        return -1;
+    }
+
+    try {
+        struct mode {
+            const char* name;
+            mpg123::waveform_options opts;
+        };
+        const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+        const mode modes[] = {
+            { "precise",          mpg123::waveform_options::precise() },
+            { "precise, threads", { .threads = cores } },
+            { "mono",             { .mono = true } },
+            { "mono, 1/2 rate",   { .mono = true, .down_sample = 1 } },
+            { "fast_preview",     mpg123::waveform_options::fast_preview() },
+            { "preview, threads", { .mono = true, .down_sample = 2, .threads = cores } },
+        };
+
+        mpg123::waveform reference;
+        double reference_ms = 0;
+        cout << std::fixed << std::setprecision(2)
+             << std::left << std::setw(20) << "mode"
+             << std::right << std::setw(10) << "ms"
+             << std::setw(10) << "speedup"
+             << std::setw(14) << "peak err max"
+             << std::setw(14) << "peak err avg"
+             << std::setw(14) << "rms err avg" << '\n';
+        for (auto& [name, opts] : modes) {
+            auto start = clock_type::now();
+            auto w = mpg123::waveform::generate(argv[1], opts);
+            const double elapsed = ms{clock_type::now() - start}.count();
+
+            if (!reference.num_levels()) {
+                reference = std::move(w);
+                reference_ms = elapsed;
+                cout << std::left << std::setw(20) << name
+                     << std::right << std::setw(10) << elapsed
+                     << std::setw(10) << 1.0 << '\n';
+                continue;
+            }
+            auto st = compare(reference, w);
+            cout << std::left << std::setw(20) << name
+                 << std::right << std::setw(10) << elapsed
+                 << std::setw(10) << reference_ms / elapsed
+                 << std::setw(13) << st.peak_max * 100 << '%'
+                 << std::setw(13) << st.peak_mean * 100 << '%'
+                 << std::setw(13) << st.rms_mean * 100 << "%\n";
+        }
+
+        cout << "Levels: " << reference.num_levels()
+             << ", size: " << reference.data().size() << " bytes for "
+             << double(reference.length()) / reference.rate() << " s" << endl;
+
+        if (argc > 2) {
+            reference.save(argv[2]);
+            auto start = clock_type::now();
+            mpg123::waveform mapped{argv[2]};
+            auto top = mapped.level(mapped.num_levels() - 1);
+            cout << "Mapped in " << ms{clock_type::now() - start}.count() << " ms, "
+                 << top.buckets.size() << " buckets at the coarsest level" << endl;
+        }
+    }
+    catch (std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return -1;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_EPOLL_MULTIPLEXER_HPP
+#define MPG123XX_EPOLL_MULTIPLEXER_HPP
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <span>
+
+
+namespace mpg123 {
+
+    struct handle;
+
+
+    // Event loop that feeds many handles from non-blocking file descriptors
+    // (sockets, pipes), watched with epoll. Whatever a descriptor has ready is read
+    // and fed into its handle, and the decoded PCM is passed to the stream's
+    // callback. Handles are only touched from the thread calling run().
+    //
+    // Backpressure: the data callback returns how many bytes it took. If it takes
+    // less than offered, the stream is paused: the rest is kept, nothing more is
+    // decoded and the descriptor isn't read, so the sender eventually blocks. Call
+    // resume() (from any thread) once the consumer can take more.
+    class epoll_multiplexer {
+
+    public:
+
+        struct options {
+            // Bytes read from a descriptor per readiness event.
+            std::size_t read_size = 16 * 1024;
+            // Bytes of PCM offered to the data callback at a time.
+            std::size_t pcm_size = 32 * 1024;
+            unsigned max_events = 64;
+        };
+
+
+        // The descriptor identifies the stream.
+        using stream_id = int;
+
+        // Returns the number of bytes consumed.
+        using data_callback = std::function<std::size_t(handle& h,
+                                                        std::span<const std::byte> pcm)>;
+
+        // Called once per stream; error is null if the stream ended normally.
+        using done_callback = std::function<void(handle& h, std::exception_ptr error)>;
+
+
+        epoll_multiplexer();
+
+        explicit
+        epoll_multiplexer(const options& opts);
+
+
+        epoll_multiplexer(epoll_multiplexer&& other)
+            noexcept;
+
+        epoll_multiplexer&
+        operator =(epoll_multiplexer&& other)
+            noexcept;
+
+
+        ~epoll_multiplexer()
+            noexcept;
+
+
+        // Watch fd and put the handle in feed mode. The descriptor is made
+        // non-blocking, but not closed; the handle and the descriptor must stay
+        // valid until done_callback is called, or the stream is removed.
+        stream_id
+        add(int fd,
+            handle& h,
+            data_callback on_data,
+            done_callback on_done = {});
+
+
+        // Stop watching fd, without calling done_callback.
+        void
+        remove(stream_id id);
+
+
+        // Offer the paused stream's PCM again; thread-safe.
+        void
+        resume(stream_id id);
+
+
+        // Process events until all streams are finished.
+        void
+        run();
+
+
+        // Wait up to timeout_ms (forever if negative) for events and process them.
+        // Returns false when there are no streams left.
+        bool
+        run_once(int timeout_ms = -1);
+
+
+        [[nodiscard]]
+        std::size_t
+        active()
+            const noexcept;
+
+
+        [[nodiscard]]
+        std::size_t
+        paused()
+            const noexcept;
+
+    private:
+
+        struct impl;
+
+        std::unique_ptr<impl> pimpl;
+
+    }; // class epoll_multiplexer
+
+} // namespace mpg123
+
+#endif
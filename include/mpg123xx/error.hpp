@@ -8,7 +8,7 @@
 #ifndef MPG123XX_ERROR_HPP
 #define MPG123XX_ERROR_HPP
 
-#include <stdexcept>
+#include <exception>
 
 
 namespace mpg123 {
@@ -16,9 +16,27 @@ namespace mpg123 {
     class handle;
 
 
-    struct error : std::runtime_error {
-        error(int code);
-        error(const handle* h);
+    // Only holds the error code and a pointer to libmpg123's static message, so
+    // creating, copying and throwing it never allocates.
+    struct error : std::exception {
+
+        int code;
+
+        error(int code)
+            noexcept;
+
+        error(const handle* h)
+            noexcept;
+
+
+        const char*
+        what()
+            const noexcept override;
+
+    private:
+
+        const char* message;
+
     };
 
 
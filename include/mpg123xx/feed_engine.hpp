@@ -0,0 +1,112 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_FEED_ENGINE_HPP
+#define MPG123XX_FEED_ENGINE_HPP
+
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    // Drives many feed-mode handles from a single thread. Each file keeps several
+    // reads in flight (through io_uring when available, otherwise through a pool of
+    // reader threads); completed reads are fed in order into the file's handle, and
+    // the decoded frames are passed to a callback. Handles are only touched from
+    // the thread calling run().
+    class feed_engine {
+
+    public:
+
+        struct options {
+            std::size_t read_size = 64 * 1024;
+            unsigned reads_per_stream = 4;
+            // Maximum number of reads in flight across all streams.
+            unsigned queue_depth = 256;
+            // Reader threads, for the fallback backend.
+            unsigned threads = 4;
+            bool use_io_uring = true;
+        };
+
+
+        using data_callback = std::function<void(handle& h, const frame& f)>;
+
+        // Called once per stream; error is null if the stream ended normally.
+        using done_callback = std::function<void(handle& h, std::exception_ptr error)>;
+
+
+        feed_engine();
+
+        explicit
+        feed_engine(const options& opts);
+
+
+        feed_engine(feed_engine&& other)
+            noexcept;
+
+        feed_engine&
+        operator =(feed_engine&& other)
+            noexcept;
+
+
+        ~feed_engine()
+            noexcept;
+
+
+        // Open the file and put the handle in feed mode. The handle must outlive
+        // the stream, until done_callback is called.
+        void
+        add(const path& filename,
+            handle& h,
+            data_callback on_data,
+            done_callback on_done = {});
+
+
+        // Process completions until all streams are finished.
+        void
+        run();
+
+
+        // Wait for and process one batch of completions. Returns false when there
+        // are no streams left.
+        bool
+        run_once();
+
+
+        [[nodiscard]]
+        std::size_t
+        active()
+            const noexcept;
+
+
+        [[nodiscard]]
+        bool
+        using_io_uring()
+            const noexcept;
+
+    private:
+
+        struct impl;
+
+        std::unique_ptr<impl> pimpl;
+
+    }; // class feed_engine
+
+} // namespace mpg123
+
+#endif
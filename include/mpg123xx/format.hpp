@@ -9,6 +9,7 @@
 #define MPG123XX_FORMAT_HPP
 
 #include <iosfwd>
+#include <span>
 #include <string>
 
 #include <fmt123.h>
@@ -36,10 +37,63 @@ namespace mpg123 {
     }
 
 
+    // True if libmpg123's synthesis writes this encoding directly; the others are
+    // produced by an extra conversion pass over the decoded samples.
+    [[nodiscard]]
+    constexpr
+    bool
+    is_native_encoding(unsigned encoding)
+        noexcept
+    {
+        switch (encoding) {
+            case MPG123_ENC_SIGNED_16:
+            case MPG123_ENC_SIGNED_32:
+            case MPG123_ENC_FLOAT_32:
+            case MPG123_ENC_SIGNED_8:
+            case MPG123_ENC_UNSIGNED_8:
+            case MPG123_ENC_ULAW_8:
+            case MPG123_ENC_ALAW_8:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    // Sample rates this build of libmpg123 can output.
+    [[nodiscard]]
+    std::span<const long>
+    supported_rates()
+        noexcept;
+
+
+    // Encodings this build of libmpg123 can output.
+    [[nodiscard]]
+    std::span<const int>
+    supported_encodings()
+        noexcept;
+
+
     struct format {
         long rate;
         unsigned channels; // bitset from mpg123_channelcount
         unsigned encoding; // bitset from mpg123_enc_enum
+
+
+        bool
+        operator ==(const format& other)
+            const noexcept = default;
+    };
+
+
+    // Describes how the decoded output relates to the stream being decoded.
+    struct conversion {
+        long input_rate;
+        unsigned input_channels;
+        format output;
+        bool resampling; // output rate differs from the stream rate
+        bool remixing;   // output channel count differs from the stream
+        bool converting; // output encoding needs a pass after synthesis
     };
 
 
@@ -51,6 +105,15 @@ namespace mpg123 {
     operator <<(std::ostream& out,
                 const format& fmt);
 
+
+    std::string
+    to_string(const conversion& conv);
+
+
+    std::ostream&
+    operator <<(std::ostream& out,
+                const conversion& conv);
+
 } // namespace mpg123
 
 #endif
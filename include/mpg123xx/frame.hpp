@@ -19,6 +19,14 @@ namespace mpg123 {
         std::span<const std::byte> samples;
     };
 
+
+    // An undecoded MPEG frame.
+    struct raw_frame {
+        std::uint32_t header;
+        std::span<const std::byte> body; // everything after the 4 header bytes
+        std::intmax_t offset;            // input position of the header
+    };
+
 } // namespace mpg123
 
 #endif
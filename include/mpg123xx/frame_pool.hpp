@@ -0,0 +1,200 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_FRAME_POOL_HPP
+#define MPG123XX_FRAME_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <mutex>
+#include <span>
+
+#include "error.hpp"
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    struct handle;
+    class frame_pool;
+
+
+    namespace detail {
+        struct frame_block;
+    }
+
+
+    // A decoded frame that owns its samples, stored in a block from a frame_pool.
+    // Copies share the block, which goes back to the pool when the last copy is
+    // gone. Copies may be used and destroyed from different threads.
+    class frame_buffer {
+
+    public:
+
+        constexpr
+        frame_buffer()
+            noexcept = default;
+
+        frame_buffer(const frame_buffer& other)
+            noexcept;
+
+        frame_buffer(frame_buffer&& other)
+            noexcept;
+
+
+        ~frame_buffer()
+            noexcept;
+
+
+        frame_buffer&
+        operator =(const frame_buffer& other)
+            noexcept;
+
+        frame_buffer&
+        operator =(frame_buffer&& other)
+            noexcept;
+
+
+        void
+        reset()
+            noexcept;
+
+
+        [[nodiscard]]
+        explicit
+        operator bool()
+            const noexcept;
+
+
+        [[nodiscard]]
+        std::intmax_t
+        num()
+            const noexcept;
+
+        [[nodiscard]]
+        std::span<const std::byte>
+        samples()
+            const noexcept;
+
+        // Only safe to write through while no other copy exists.
+        [[nodiscard]]
+        std::span<std::byte>
+        mutable_samples()
+            noexcept;
+
+
+        [[nodiscard]]
+        bool
+        unique()
+            const noexcept;
+
+    private:
+
+        friend class frame_pool;
+
+        explicit
+        frame_buffer(detail::frame_block* block)
+            noexcept;
+
+        detail::frame_block* block = nullptr;
+
+    }; // class frame_buffer
+
+
+    // Recycles fixed-size blocks for frame_buffer. Blocks are only allocated when
+    // none is free, so a pipeline in steady state doesn't allocate per frame.
+    // All members are thread-safe. The pool must outlive its frame_buffers.
+    class frame_pool {
+
+    public:
+
+        // A block_size of handle::outblock() fits any frame of that handle.
+        explicit
+        frame_pool(std::size_t block_size,
+                   std::size_t initial_blocks = 0);
+
+        frame_pool(const frame_pool&) = delete;
+
+
+        ~frame_pool()
+            noexcept;
+
+
+        [[nodiscard]]
+        std::size_t
+        block_size()
+            const noexcept;
+
+        // Blocks allocated so far.
+        [[nodiscard]]
+        std::size_t
+        capacity()
+            const noexcept;
+
+        // Blocks not held by any frame_buffer.
+        [[nodiscard]]
+        std::size_t
+        available()
+            const noexcept;
+
+
+        void
+        reserve(std::size_t blocks);
+
+
+        // Copy a frame into a block; throws std::length_error if it doesn't fit.
+        frame_buffer
+        copy(const frame& f);
+
+
+        // Decode the next frame straight into a block, with a single copy out of
+        // libmpg123's buffer.
+        frame_buffer
+        decode(handle& h);
+
+        std::expected<frame_buffer, error>
+        try_decode(handle& h)
+            noexcept;
+
+
+        // Let libmpg123 decode into a fresh block (see handle::replace_buffer()),
+        // with no copy at all. The block_size must be at least h.outblock(). The
+        // handle keeps writing into the last block it was given, so once this is
+        // used, only decode from that handle through decode_direct().
+        frame_buffer
+        decode_direct(handle& h);
+
+        std::expected<frame_buffer, error>
+        try_decode_direct(handle& h)
+            noexcept;
+
+    private:
+
+        friend class frame_buffer;
+
+        detail::frame_block*
+        acquire();
+
+        void
+        release(detail::frame_block* block)
+            noexcept;
+
+
+        const std::size_t size;
+
+        mutable std::mutex mutex;
+        detail::frame_block* free_list = nullptr;
+        detail::frame_block* all_blocks = nullptr;
+        std::size_t num_blocks = 0;
+        std::size_t num_free = 0;
+
+    }; // class frame_pool
+
+} // namespace mpg123
+
+#endif
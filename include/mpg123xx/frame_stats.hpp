@@ -0,0 +1,110 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_FRAME_STATS_HPP
+#define MPG123XX_FRAME_STATS_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+
+#include <mpg123.h>
+
+#include "error.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    // What the frame headers of a stream say, gathered without decoding.
+    struct frame_stats {
+
+        std::uintmax_t frames = 0;
+        std::uintmax_t bytes = 0;   // in frames, headers included
+        double duration = 0;        // seconds
+
+        // Frame counts by bitrate (kbit/s; 0 is free format) and sampling rate.
+        std::map<int, std::uintmax_t> bitrates;
+        std::map<long, std::uintmax_t> rates;
+
+        // Frame counts indexed by mpg123_version, layer and mpg123_mode.
+        std::array<std::uintmax_t, 3> versions{};
+        std::array<std::uintmax_t, 4> layers{};
+        std::array<std::uintmax_t, 4> modes{};
+
+        std::uintmax_t crc_frames = 0;
+
+        // What the Xing/Info/VBRI header declared, if any.
+        mpg123_vbr declared_vbr = MPG123_CBR;
+
+        // Input position of the first frame (after any leading tags) and the end
+        // of the last one.
+        std::intmax_t first_offset = -1;
+        std::intmax_t end_offset = -1;
+
+        // Garbage between frames, where the parser lost sync and searched for the
+        // next header.
+        std::uintmax_t resyncs = 0;
+        std::uintmax_t skipped_bytes = 0;
+
+        // Frames whose parameters differ from the previous one's (rate, channels).
+        std::uintmax_t format_changes = 0;
+
+        // The error that stopped the scan before the end of the stream.
+        std::optional<error> failure;
+
+
+        [[nodiscard]]
+        bool
+        is_vbr()
+            const noexcept
+        {
+            return bitrates.size() > 1;
+        }
+
+
+        // Average bitrate over the frames, in kbit/s.
+        [[nodiscard]]
+        double
+        average_bitrate()
+            const noexcept
+        {
+            return duration > 0 ? bytes * 8 / duration / 1000 : 0;
+        }
+
+
+        // No lost sync, no format changes, and the stream ended cleanly.
+        [[nodiscard]]
+        bool
+        is_clean()
+            const noexcept
+        {
+            return frames && !resyncs && !format_changes && !failure;
+        }
+
+    }; // struct frame_stats
+
+
+    // Walk the rest of the stream in frame-by-frame mode, only parsing headers;
+    // nothing is decoded.
+    [[nodiscard]]
+    frame_stats
+    scan_frames(handle& h);
+
+    [[nodiscard]]
+    frame_stats
+    scan_frames(const path& filename);
+
+} // namespace mpg123
+
+#endif
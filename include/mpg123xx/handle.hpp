@@ -8,9 +8,12 @@
 #ifndef MPG123XX_HANDLE_HPP
 #define MPG123XX_HANDLE_HPP
 
+#include <concepts>
 #include <cstddef>
+#include <cstdio> // SEEK_SET
 #include <expected>
 #include <filesystem>
+#include <memory_resource>
 #include <span>
 #include <string>
 
@@ -21,6 +24,9 @@
 #include "format.hpp"
 #include "frame.hpp"
 #include "id3.hpp"
+#include "memory_profile.hpp"
+#include "seek.hpp"
+#include "volume.hpp"
 
 
 namespace mpg123 {
@@ -28,6 +34,21 @@ namespace mpg123 {
     using std::filesystem::path;
 
 
+    // Real-time-safe subset: once a stream is open and its first frame was decoded,
+    // these don't allocate, lock or throw, and report errors without allocating:
+    //
+    //   try_read(), try_decode_frame(), try_framebyframe_next(),
+    //   try_framebyframe_decode(), try_get_frame_data(), framepos(), tell(),
+    //   tellframe(), try_set_volume(), try_change_volume(), try_change_volume_db(),
+    //   try_set_eq(), get_eq(), try_set_equalizer(), set_rva(), get_rva().
+    //
+    // The throwing variants allocate the exception. A new output format
+    // (MPG123_NEW_FORMAT) may reallocate the output buffer. A stream opened from a
+    // file still blocks in read(2); the audio thread should use a feed handle.
+    // try_feed() only stays allocation-free while the feed pool (MPG123_FEEDPOOL)
+    // has a free buffer for each chunk.
+    //
+    // examples/rt_check verifies this on a given file.
     struct handle : basic_wrapper<mpg123_handle*> {
 
         using parent_type = basic_wrapper<mpg123_handle*>;
@@ -51,6 +72,10 @@ namespace mpg123 {
 
         handle(const std::string& decoder);
 
+        explicit
+        handle(const memory_profile& profile,
+               const char* decoder = nullptr);
+
 
         // Named constructor: create handle and open file.
         [[nodiscard]]
@@ -66,6 +91,13 @@ namespace mpg123 {
                   mpg123_channelcount channels,
                   mpg123_enc_enum encoding);
 
+        // Named constructor: create handle, set the seek policy and open file.
+        [[nodiscard]]
+        static
+        handle
+        from_file(const path& filename,
+                  const seek_policy& policy);
+
 
         ~handle()
             noexcept;
@@ -112,6 +144,142 @@ namespace mpg123 {
             noexcept;
 
 
+        // Decode at 1/2^factor of the stream's rate (0, 1 or 2), skipping the
+        // upper subbands instead of resampling. Must be set before opening a
+        // stream.
+        void
+        set_down_sample(int factor);
+
+        std::expected<void, error>
+        try_set_down_sample(int factor)
+            noexcept;
+
+
+        // Resample every stream to this rate (MPG123_FORCE_RATE), or 0 to keep
+        // the stream's rate. Needs a libmpg123 built with the NtoM resampler. Must
+        // be set before opening a stream.
+        void
+        set_force_rate(long rate);
+
+        std::expected<void, error>
+        try_set_force_rate(long rate)
+            noexcept;
+
+
+        // Must be set before opening a stream.
+        void
+        set_memory_profile(const memory_profile& profile);
+
+        std::expected<void, error>
+        try_set_memory_profile(const memory_profile& profile)
+            noexcept;
+
+
+        // Approximate heap memory used by this handle: the fixed part (measured
+        // once, where the C library allows it), the seek index, the feed buffers
+        // and the output buffer.
+        [[nodiscard]]
+        std::size_t
+        resident_bytes()
+            noexcept;
+
+
+        // Must be set before opening a stream.
+        void
+        set_seek_policy(const seek_policy& policy);
+
+        std::expected<void, error>
+        try_set_seek_policy(const seek_policy& policy)
+            noexcept;
+
+
+        // Volume, RVA and equalizer are applied inside the synthesis, starting with
+        // the next decoded frame.
+
+        void
+        set_volume(double vol);
+
+        std::expected<void, error>
+        try_set_volume(double vol)
+            noexcept;
+
+
+        void
+        change_volume(double delta);
+
+        std::expected<void, error>
+        try_change_volume(double delta)
+            noexcept;
+
+
+        void
+        change_volume_db(double db);
+
+        std::expected<void, error>
+        try_change_volume_db(double db)
+            noexcept;
+
+
+        volume
+        get_volume();
+
+        std::expected<volume, error>
+        try_get_volume()
+            noexcept;
+
+
+        void
+        set_rva(mpg123_param_rva mode)
+            noexcept;
+
+        mpg123_param_rva
+        get_rva()
+            const noexcept;
+
+
+        void
+        set_eq(mpg123_channels channel,
+               int band,
+               double value);
+
+        std::expected<void, error>
+        try_set_eq(mpg123_channels channel,
+                   int band,
+                   double value)
+            noexcept;
+
+
+        [[nodiscard]]
+        double
+        get_eq(mpg123_channels channel,
+               int band)
+            noexcept;
+
+
+        // Set all bands of both channels at once. On failure the previous curve
+        // is restored.
+        void
+        set_equalizer(const equalizer& eq);
+
+        std::expected<void, error>
+        try_set_equalizer(const equalizer& eq)
+            noexcept;
+
+
+        [[nodiscard]]
+        equalizer
+        get_equalizer()
+            noexcept;
+
+
+        void
+        reset_eq();
+
+        std::expected<void, error>
+        try_reset_eq()
+            noexcept;
+
+
         format
         get_format();
 
@@ -132,6 +300,82 @@ namespace mpg123 {
             noexcept;
 
 
+        // Disable all output formats.
+        void
+        format_none();
+
+        std::expected<void, error>
+        try_format_none()
+            noexcept;
+
+
+        // Enable all output formats supported by this build.
+        void
+        format_all();
+
+        std::expected<void, error>
+        try_format_all()
+            noexcept;
+
+
+        // Returns the channels (MPG123_MONO | MPG123_STEREO) currently enabled for
+        // this rate and encoding, or 0 if disabled.
+        [[nodiscard]]
+        unsigned
+        format_support(long rate,
+                       unsigned encoding)
+            noexcept;
+
+
+        // Restrict the output to the first usable encoding from the sink's list, so
+        // libmpg123 decodes straight into it. Encodings written natively by the
+        // synthesis are picked before ones that need a conversion pass. A rate of 0
+        // allows any rate, which lets libmpg123 keep the stream's own rate.
+        // Returns the chosen encoding; if none fits, the format table is left as
+        // it was.
+        unsigned
+        negotiate_format(std::span<const unsigned> encodings,
+                         unsigned channels = MPG123_MONO | MPG123_STEREO,
+                         long rate = 0);
+
+        std::expected<unsigned, error>
+        try_negotiate_format(std::span<const unsigned> encodings,
+                             unsigned channels = MPG123_MONO | MPG123_STEREO,
+                             long rate = 0)
+            noexcept;
+
+
+        // Make every stream come out in exactly this format, whatever its rate and
+        // mode: libmpg123 resamples to fmt.rate, and mixes or duplicates channels
+        // to fmt.channels (MPG123_MONO or MPG123_STEREO). The output format then
+        // never changes mid-stream. Must be set before opening a stream. On
+        // failure, the forced rate and the flags are restored.
+        void
+        force_format(const format& fmt);
+
+        std::expected<void, error>
+        try_force_format(const format& fmt)
+            noexcept;
+
+
+        // Compare the output format with the stream, to find out if libmpg123 will
+        // resample or convert internally.
+        conversion
+        get_conversion();
+
+        std::expected<conversion, error>
+        try_get_conversion()
+            noexcept;
+
+
+        mpg123_frameinfo2
+        get_info();
+
+        std::expected<mpg123_frameinfo2, error>
+        try_get_info()
+            noexcept;
+
+
         void
         open_feed();
 
@@ -181,6 +425,9 @@ namespace mpg123 {
         }
 
 
+        // Data decoded before MPG123_DONE, MPG123_NEED_MORE or MPG123_NEW_FORMAT
+        // is returned first; the next call reports the condition, so the data is
+        // always in the format from before the change.
         std::expected<std::size_t, error>
         try_read(void* buf,
                  std::size_t size)
@@ -204,18 +451,86 @@ namespace mpg123 {
             noexcept;
 
 
+        // Frame-by-frame mode: parse the next frame without decoding it. Returns
+        // true if this frame starts a new output format.
+        bool
+        framebyframe_next();
+
+        std::expected<bool, error>
+        try_framebyframe_next()
+            noexcept;
+
+
+        // Decode the frame loaded by framebyframe_next().
+        frame
+        framebyframe_decode();
+
+        std::expected<frame, error>
+        try_framebyframe_decode()
+            noexcept;
+
+
+        // The undecoded frame loaded by framebyframe_next().
+        raw_frame
+        get_frame_data();
+
+        std::expected<raw_frame, error>
+        try_get_frame_data()
+            noexcept;
+
+
+        // Decode into a caller-owned buffer instead of libmpg123's own, so the
+        // samples returned by decode_frame() and framebyframe_decode() already sit
+        // there. The buffer must hold at least outblock() bytes and stay valid for
+        // as long as the handle decodes; read() still copies out of it.
+        void
+        replace_buffer(std::span<std::byte> buf);
+
+        std::expected<void, error>
+        try_replace_buffer(std::span<std::byte> buf)
+            noexcept;
+
+
+        // Maximum number of bytes one decoded frame can take, with the current
+        // output settings.
+        [[nodiscard]]
+        std::size_t
+        outblock()
+            noexcept;
+
+
+        // Duration of one frame, in seconds.
+        [[nodiscard]]
+        double
+        tpf()
+            noexcept;
+
+
+        // Input position of the last parsed frame.
+        [[nodiscard]]
+        std::intmax_t
+        framepos()
+            noexcept;
+
+
         void
         feed(const void* buf,
              std::size_t size);
 
         template<typename T,
                  std::size_t E>
+        requires (!std::same_as<T, std::span<const std::byte>>)
         void
         feed(std::span<const T, E> buf)
         {
             feed(buf.data(), buf.size_bytes());
         }
 
+        // Feed a chain of fragments, in order, without coalescing them first;
+        // libmpg123 packs consecutive fragments into its own buffer blocks.
+        void
+        feed(std::span<const std::span<const std::byte>> fragments);
+
 
         std::expected<void, error>
         try_feed(const void* buf,
@@ -224,6 +539,7 @@ namespace mpg123 {
 
         template<typename T,
                  std::size_t E>
+        requires (!std::same_as<T, std::span<const std::byte>>)
         std::expected<void, error>
         try_feed(std::span<const T, E> buf)
             noexcept
@@ -231,6 +547,90 @@ namespace mpg123 {
             return try_feed(buf.data(), buf.size_bytes());
         }
 
+        // On error, the fragments before the failing one were already fed.
+        std::expected<void, error>
+        try_feed(std::span<const std::span<const std::byte>> fragments)
+            noexcept;
+
+
+        // Returns the new position, in samples.
+        std::intmax_t
+        seek(std::intmax_t sample,
+             int whence = SEEK_SET);
+
+        std::expected<std::intmax_t, error>
+        try_seek(std::intmax_t sample,
+                 int whence = SEEK_SET)
+            noexcept;
+
+
+        // Returns the new position, in frames.
+        std::intmax_t
+        seek_frame(std::intmax_t frame,
+                   int whence = SEEK_SET);
+
+        std::expected<std::intmax_t, error>
+        try_seek_frame(std::intmax_t frame,
+                       int whence = SEEK_SET)
+            noexcept;
+
+
+        // Current output position, in samples.
+        [[nodiscard]]
+        std::intmax_t
+        tell()
+            noexcept;
+
+        // Number of the frame that will be decoded next.
+        [[nodiscard]]
+        std::intmax_t
+        tellframe()
+            noexcept;
+
+
+        // Read through the whole stream to build the seek index and find the exact
+        // length, then go back to the start.
+        void
+        scan();
+
+        std::expected<void, error>
+        try_scan()
+            noexcept;
+
+
+        seek_index
+        get_seek_index();
+
+        std::expected<seek_index, error>
+        try_get_seek_index()
+            noexcept;
+
+        // Load an index taken from another handle on the same stream, so seeks
+        // don't have to scan for it again. The entries are copied.
+        void
+        set_seek_index(const seek_index& index);
+
+        std::expected<void, error>
+        try_set_seek_index(const seek_index& index)
+            noexcept;
+
+
+        // Total length in samples, after gapless trimming.
+        std::intmax_t
+        length();
+
+        std::expected<std::intmax_t, error>
+        try_length()
+            noexcept;
+
+
+        long
+        get_state(mpg123_state key);
+
+        std::expected<long, error>
+        try_get_state(mpg123_state key)
+            noexcept;
+
 
         unsigned
         meta_check()
@@ -243,6 +643,21 @@ namespace mpg123 {
         try_get_id3()
             noexcept;
 
+        // Allocate the tags from this memory resource; null is rejected with
+        // MPG123_NULL_POINTER.
+        pmr::id3
+        get_id3(std::pmr::memory_resource* resource);
+
+        std::expected<pmr::id3, error>
+        try_get_id3(std::pmr::memory_resource* resource)
+            noexcept;
+
+    private:
+
+        // try_read() returned data that came with MPG123_NEW_FORMAT; the next call
+        // reports it.
+        bool new_format_pending = false;
+
     };
 
 } // namespace mpg123
@@ -10,6 +10,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <vector>
@@ -19,91 +21,234 @@
 
 namespace mpg123 {
 
-    struct id3v1 {
+    namespace detail {
 
-        std::string  title;
-        std::string  artist;
-        std::string  album;
-        std::string  year;
-        std::string  comment;
+        template<typename Alloc,
+                 typename T>
+        using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+        template<typename Alloc>
+        using basic_string = std::basic_string<char,
+                                               std::char_traits<char>,
+                                               rebind_alloc<Alloc, char>>;
+
+        template<typename Alloc,
+                 typename T>
+        using basic_vector = std::vector<T, rebind_alloc<Alloc, T>>;
+
+    } // namespace detail
+
+
+    // The ID3 types are allocator-aware: the pmr:: aliases below allocate all their
+    // strings and lists from one std::pmr::memory_resource.
+
+
+    template<typename Alloc>
+    struct basic_id3v1 {
+
+        using allocator_type = Alloc;
+        using string_type = detail::basic_string<Alloc>;
+
+        string_type  title;
+        string_type  artist;
+        string_type  album;
+        string_type  year;
+        string_type  comment;
         std::uint8_t track = 0; // only for ID3v1.1
         std::uint8_t genre = 0;
 
 
         constexpr
-        id3v1()
+        basic_id3v1()
             noexcept = default;
 
-        id3v1(const mpg123_id3v1* src);
+        explicit
+        basic_id3v1(const allocator_type& alloc)
+            noexcept;
+
+        basic_id3v1(const mpg123_id3v1* src,
+                    const allocator_type& alloc = {});
+
+        basic_id3v1(const basic_id3v1& other,
+                    const allocator_type& alloc);
+
+        basic_id3v1(basic_id3v1&& other,
+                    const allocator_type& alloc);
 
-    }; // struct id3v1
+    }; // struct basic_id3v1
 
 
-    struct text {
-        std::string lang;
-        std::string id;
-        std::string description;
-        std::string data;
+    template<typename Alloc>
+    struct basic_text {
+
+        using allocator_type = Alloc;
+        using string_type = detail::basic_string<Alloc>;
+
+        string_type lang;
+        string_type id;
+        string_type description;
+        string_type data;
 
         constexpr
-        text()
+        basic_text()
             noexcept = default;
 
+        explicit
+        basic_text(const allocator_type& alloc)
+            noexcept;
+
+        basic_text(const mpg123_text* src,
+                   const allocator_type& alloc = {});
+
+        basic_text(const mpg123_text& src,
+                   const allocator_type& alloc = {});
+
+        basic_text(const basic_text& other,
+                   const allocator_type& alloc);
+
+        basic_text(basic_text&& other,
+                   const allocator_type& alloc);
 
-        text(const mpg123_text* src);
+    }; // struct basic_text
 
-        text(const mpg123_text& src);
 
-    }; // struct text
+    template<typename Alloc>
+    struct basic_picture {
+
+        using allocator_type = Alloc;
+        using string_type = detail::basic_string<Alloc>;
+
+        mpg123_id3_pic_type type = mpg123_id3_pic_other;
+        string_type description;
+        string_type mime_type;
+        detail::basic_vector<Alloc, std::byte> data;
+
+        constexpr
+        basic_picture()
+            noexcept = default;
 
-    struct picture {
-        mpg123_id3_pic_type type;
-        std::string description;
-        std::string mime_type;
-        std::vector<std::byte> data;
-    }; // struct picture
+        explicit
+        basic_picture(const allocator_type& alloc)
+            noexcept;
 
+        basic_picture(const mpg123_picture& src,
+                      const allocator_type& alloc = {});
 
-    struct id3v2 {
+        basic_picture(const basic_picture& other,
+                      const allocator_type& alloc);
 
-        std::uint8_t version;
+        basic_picture(basic_picture&& other,
+                      const allocator_type& alloc);
 
-        std::string title;
-        std::string artist;
-        std::string album;
-        std::string year;
-        std::string genre;
-        std::string comment;
+    }; // struct basic_picture
 
-        std::vector<text> comments;
-        std::vector<text> texts;
-        std::vector<text> extras;
-        std::vector<picture> pictures;
+
+    template<typename Alloc>
+    struct basic_id3v2 {
+
+        using allocator_type = Alloc;
+        using string_type = detail::basic_string<Alloc>;
+        using text_type = basic_text<Alloc>;
+        using picture_type = basic_picture<Alloc>;
+
+        std::uint8_t version = 0;
+
+        string_type title;
+        string_type artist;
+        string_type album;
+        string_type year;
+        string_type genre;
+        string_type comment;
+
+        detail::basic_vector<Alloc, text_type> comments;
+        detail::basic_vector<Alloc, text_type> texts;
+        detail::basic_vector<Alloc, text_type> extras;
+        // Only filled if the handle has the MPG123_PICTURE flag.
+        detail::basic_vector<Alloc, picture_type> pictures;
 
 
         constexpr
-        id3v2()
+        basic_id3v2()
             noexcept = default;
 
-        id3v2(const mpg123_id3v2* src);
+        explicit
+        basic_id3v2(const allocator_type& alloc)
+            noexcept;
+
+        basic_id3v2(const mpg123_id3v2* src,
+                    const allocator_type& alloc = {});
 
-    }; // struct id3v2
+        basic_id3v2(const basic_id3v2& other,
+                    const allocator_type& alloc);
 
+        basic_id3v2(basic_id3v2&& other,
+                    const allocator_type& alloc);
 
-    struct id3 {
-        std::optional<id3v1> v1;
-        std::optional<id3v2> v2;
+    }; // struct basic_id3v2
+
+
+    template<typename Alloc>
+    struct basic_id3 {
+
+        using allocator_type = Alloc;
+
+        std::optional<basic_id3v1<Alloc>> v1;
+        std::optional<basic_id3v2<Alloc>> v2;
 
         constexpr
-        id3()
+        basic_id3()
             noexcept = default;
 
+        // No tags. Lets allocator-aware containers default-construct it.
+        explicit
+        basic_id3(const allocator_type& alloc)
+            noexcept;
+
+
+        basic_id3(mpg123_id3v1* tag1,
+                  mpg123_id3v2* tag2,
+                  const allocator_type& alloc = {});
+
+        basic_id3(const basic_id3& other,
+                  const allocator_type& alloc);
+
+        basic_id3(basic_id3&& other,
+                  const allocator_type& alloc);
+
+    }; // struct basic_id3
+
+
+    using id3v1   = basic_id3v1<std::allocator<char>>;
+    using text    = basic_text<std::allocator<char>>;
+    using picture = basic_picture<std::allocator<char>>;
+    using id3v2   = basic_id3v2<std::allocator<char>>;
+    using id3     = basic_id3<std::allocator<char>>;
+
+
+    namespace pmr {
+
+        using id3v1   = basic_id3v1<std::pmr::polymorphic_allocator<char>>;
+        using text    = basic_text<std::pmr::polymorphic_allocator<char>>;
+        using picture = basic_picture<std::pmr::polymorphic_allocator<char>>;
+        using id3v2   = basic_id3v2<std::pmr::polymorphic_allocator<char>>;
+        using id3     = basic_id3<std::pmr::polymorphic_allocator<char>>;
+
+    } // namespace pmr
+
 
-        id3(mpg123_id3v1* tag1,
-            mpg123_id3v2* tag2);
+    // Note: the members are defined in id3.cpp, only for these two allocators.
 
-    }; // struct id3
+    extern template struct basic_id3v1<std::allocator<char>>;
+    extern template struct basic_text<std::allocator<char>>;
+    extern template struct basic_picture<std::allocator<char>>;
+    extern template struct basic_id3v2<std::allocator<char>>;
+    extern template struct basic_id3<std::allocator<char>>;
 
+    extern template struct basic_id3v1<std::pmr::polymorphic_allocator<char>>;
+    extern template struct basic_text<std::pmr::polymorphic_allocator<char>>;
+    extern template struct basic_picture<std::pmr::polymorphic_allocator<char>>;
+    extern template struct basic_id3v2<std::pmr::polymorphic_allocator<char>>;
+    extern template struct basic_id3<std::pmr::polymorphic_allocator<char>>;
 
 } // namespace mpg123
 
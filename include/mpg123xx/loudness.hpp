@@ -0,0 +1,162 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_LOUDNESS_HPP
+#define MPG123XX_LOUDNESS_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <vector>
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    struct loudness {
+
+        double integrated = -std::numeric_limits<double>::infinity(); // LUFS
+        double range = 0;       // LU
+        double true_peak = 0;   // linear, 1.0 is full scale
+        double sample_peak = 0; // linear
+
+
+        // ReplayGain 2.0: the gain (dB) that brings the integrated loudness to
+        // -18 LUFS.
+        [[nodiscard]]
+        double
+        replaygain()
+            const noexcept
+        {
+            return -18.0 - integrated;
+        }
+
+
+        [[nodiscard]]
+        double
+        true_peak_db()
+            const noexcept
+        {
+            return 20.0 * std::log10(true_peak);
+        }
+
+    }; // struct loudness
+
+
+    // EBU R128 / ITU-R BS.1770-4 meter over interleaved float samples, mono or
+    // stereo: integrated loudness (gated 400 ms blocks), loudness range (EBU
+    // Tech 3342, 3 s blocks), true peak (4x oversampled below 96 kHz) and sample
+    // peak.
+    class loudness_meter {
+
+    public:
+
+        loudness_meter(long rate,
+                       unsigned channels);
+
+
+        void
+        process(std::span<const float> samples);
+
+
+        [[nodiscard]]
+        loudness
+        result()
+            const;
+
+
+        // Add the other meter's blocks and peaks, as if its input came after
+        // this one's; meant for album loudness. The rates may differ.
+        void
+        merge(const loudness_meter& other);
+
+
+        void
+        reset()
+            noexcept;
+
+    private:
+
+        long rate;
+        unsigned channels;
+
+        // K-weighting: a high shelf and a high-pass biquad, per channel.
+        std::array<double, 5> shelf;    // b0, b1, b2, a1, a2
+        std::array<double, 5> highpass;
+        std::vector<double> state;      // 4 per channel
+
+        // Mean square of the weighted signal in 100 ms steps.
+        std::size_t step_len;
+        std::size_t step_fill = 0;
+        double step_sum = 0;
+        std::array<double, 30> recent_steps{}; // last 3 s
+        std::size_t num_steps = 0;
+
+        // Mean square of every 400 ms and 3 s block, at 100 ms steps.
+        std::vector<double> momentary;
+        std::vector<double> short_term;
+
+        // True peak interpolator: factor phases of taps coefficients each.
+        unsigned factor;
+        unsigned taps;
+        std::vector<float> coeffs;
+        std::vector<float> history;     // 2 * taps per channel
+        unsigned hist_pos = 0;
+
+        double true_peak = 0;
+        double sample_peak = 0;
+
+
+        template<unsigned C>
+        void
+        weigh(const float* in,
+              std::size_t frames);
+
+        void
+        oversample(const float* in,
+                   std::size_t frames);
+
+        void
+        end_step();
+
+    }; // class loudness_meter
+
+
+    // Decode the rest of the stream and measure it. The handle must decode to
+    // MPG123_ENC_FLOAT_32.
+    [[nodiscard]]
+    loudness
+    analyze_loudness(handle& h);
+
+    [[nodiscard]]
+    loudness
+    analyze_loudness(const path& filename);
+
+
+    struct album_loudness {
+        std::vector<loudness> tracks; // in the same order as the files
+        loudness album;
+    };
+
+
+    // Measure each file on its own worker (threads = 0 for one per core), then
+    // the album as a whole from the tracks' blocks.
+    [[nodiscard]]
+    album_loudness
+    analyze_album(std::span<const path> files,
+                  unsigned threads = 0);
+
+} // namespace mpg123
+
+#endif
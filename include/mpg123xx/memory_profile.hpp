@@ -0,0 +1,67 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_MEMORY_PROFILE_HPP
+#define MPG123XX_MEMORY_PROFILE_HPP
+
+
+namespace mpg123 {
+
+    // Settings that trade features for a smaller handle.
+    struct memory_profile {
+
+        // Seek index entries; see seek_policy.
+        long index_size = 1000;
+
+        // Don't parse ID3v2 tags at all.
+        bool skip_id3v2 = false;
+
+        // Don't use the Xing/Info frame; loses gapless info and the exact length.
+        bool ignore_infoframe = false;
+
+        // Keep ID3v2 pictures (MPG123_PICTURE).
+        bool pictures = false;
+
+        // Buffers kept for reuse by feed(), and the size of each.
+        long feed_pool = 5;
+        long feed_buffer = 4096;
+
+
+        // libmpg123's defaults.
+        [[nodiscard]]
+        static constexpr
+        memory_profile
+        defaults()
+            noexcept
+        {
+            return {};
+        }
+
+
+        // For many concurrent feed-mode streams that are only decoded: no tags,
+        // no seeking, small feed buffers.
+        [[nodiscard]]
+        static constexpr
+        memory_profile
+        lean()
+            noexcept
+        {
+            return {
+                .index_size = 0,
+                .skip_id3v2 = true,
+                .ignore_infoframe = true,
+                .pictures = false,
+                .feed_pool = 2,
+                .feed_buffer = 1024
+            };
+        }
+
+    }; // struct memory_profile
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_METADATA_CACHE_HPP
+#define MPG123XX_METADATA_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "format.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    struct metadata {
+
+        format fmt{};
+        std::intmax_t length = -1; // samples, -1 if unknown
+        long enc_delay = 0;        // gapless info
+        long enc_padding = 0;
+
+        // From ID3v2 when present, otherwise from ID3v1.
+        std::string title;
+        std::string artist;
+        std::string album;
+        std::string year;
+        std::string genre;
+        std::string comment;
+
+
+        [[nodiscard]]
+        static
+        metadata
+        from_file(const path& filename);
+
+        [[nodiscard]]
+        static
+        metadata
+        from_handle(handle& h);
+
+    }; // struct metadata
+
+
+    // Identifies one version of a file; any change invalidates its cache entry.
+    struct file_key {
+        std::uint64_t dev;
+        std::uint64_t ino;
+        std::uint64_t size;
+        std::int64_t mtime_ns;
+
+        [[nodiscard]]
+        static
+        std::optional<file_key>
+        from_file(const path& filename)
+            noexcept;
+
+        bool
+        operator ==(const file_key& other)
+            const noexcept = default;
+    };
+
+
+    // Read-only view of a cache file, mapped in memory. The file is only ever
+    // replaced as a whole (see metadata_cache_writer), so any number of processes
+    // can read it while it's being rewritten.
+    class metadata_cache {
+
+    public:
+
+        metadata_cache()
+            noexcept = default;
+
+        // A missing or corrupt file gives an empty cache.
+        explicit
+        metadata_cache(const path& filename);
+
+
+        /// Move constructor.
+        metadata_cache(metadata_cache&& other)
+            noexcept;
+
+        /// Move assignment.
+        metadata_cache&
+        operator =(metadata_cache&& other)
+            noexcept;
+
+
+        ~metadata_cache()
+            noexcept;
+
+
+        void
+        open(const path& filename);
+
+        void
+        close()
+            noexcept;
+
+
+        [[nodiscard]]
+        std::optional<metadata>
+        find(const file_key& key)
+            const;
+
+        // Returns nothing if the file is not cached, or changed since.
+        [[nodiscard]]
+        std::optional<metadata>
+        find(const path& filename)
+            const;
+
+
+        [[nodiscard]]
+        std::size_t
+        size()
+            const noexcept;
+
+    private:
+
+        const std::byte* base = nullptr;
+        std::size_t mapped_size = 0;
+        std::size_t count = 0;
+        const std::byte* records = nullptr;
+        const char* strings = nullptr;
+        std::size_t strings_size = 0;
+
+    }; // class metadata_cache
+
+
+    // Builds a new cache file. commit() writes it to a temporary file and renames
+    // it over the old one, so readers see either the old or the new cache.
+    // Only one writer should commit to the same file at a time.
+    class metadata_cache_writer {
+
+    public:
+
+        explicit
+        metadata_cache_writer(const path& filename);
+
+
+        void
+        add(const file_key& key,
+            metadata meta);
+
+
+        // Reuse the cached entry when the file didn't change, otherwise scan it.
+        // Returns nothing if the file could not be read.
+        std::optional<metadata>
+        update(const metadata_cache& old,
+               const path& filename);
+
+
+        [[nodiscard]]
+        std::size_t
+        size()
+            const noexcept;
+
+
+        void
+        commit();
+
+    private:
+
+        path filename;
+        std::vector<std::pair<file_key, metadata>> entries;
+
+    }; // class metadata_cache_writer
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_MIXER_HPP
+#define MPG123XX_MIXER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "handle.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+
+    // Decodes several streams as float32 and sums them into fixed-size blocks.
+    // Each input is decoded at the mixer's rate and channel count, letting
+    // libmpg123 resample or remix as needed. All buffers are allocated by add();
+    // mix() and the gain controls don't allocate.
+    class mixer {
+
+    public:
+
+        struct options {
+            long rate = 48000;
+            unsigned channels = 2;   // 1 or 2
+            std::size_t block_frames = 1024;
+        };
+
+
+        using input_id = std::size_t;
+
+
+        mixer();
+
+        explicit
+        mixer(const options& opts);
+
+
+        // Restrict the handle's output to the mixer's format; call before opening.
+        void
+        configure(handle& h)
+            const;
+
+
+        // Open a file as a new input.
+        input_id
+        add_file(const path& filename,
+                 float gain = 1.0f);
+
+        // Take an opened handle, configured with configure().
+        input_id
+        add(handle&& h,
+            float gain = 1.0f);
+
+
+        [[nodiscard]]
+        std::size_t
+        size()
+            const noexcept;
+
+
+        [[nodiscard]]
+        handle&
+        get_handle(input_id id)
+            noexcept;
+
+
+        // Change the gain at the start of the next block.
+        void
+        set_gain(input_id id,
+                 float gain)
+            noexcept;
+
+
+        [[nodiscard]]
+        float
+        get_gain(input_id id)
+            const noexcept;
+
+
+        // Linear ramp from the current gain to target, over this many sample frames.
+        void
+        fade(input_id id,
+             float target,
+             std::size_t frames)
+            noexcept;
+
+
+        // True once the input reached the end of its stream, or failed.
+        [[nodiscard]]
+        bool
+        finished(input_id id)
+            const noexcept;
+
+        // Why the input stopped early, if it did.
+        [[nodiscard]]
+        std::optional<error>
+        get_error(input_id id)
+            const;
+
+
+        // Decode and sum one block. Returns block_frames * channels interleaved
+        // samples, valid until the next call. An input that fails to decode is
+        // finished with an error (see get_error()); the others keep playing.
+        std::span<const float>
+        mix();
+
+
+        [[nodiscard]]
+        const options&
+        get_options()
+            const noexcept;
+
+
+        [[nodiscard]]
+        std::size_t
+        block_samples()
+            const noexcept;
+
+    private:
+
+        struct input {
+            handle h;
+            std::unique_ptr<float[]> buffer;
+            float gain;
+            float target;
+            float step = 0;
+            std::size_t ramp = 0; // frames left in the fade
+            bool done = false;
+            std::optional<error> failure{};
+        };
+
+        options opts;
+        std::vector<input> inputs;
+        std::unique_ptr<float[]> output;
+
+
+        void
+        decode(input& in);
+
+    }; // class mixer
+
+} // namespace mpg123
+
+#endif
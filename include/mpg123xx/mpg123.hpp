@@ -10,10 +10,30 @@
 
 #include <string>
 
+#include "epoll_multiplexer.hpp"
 #include "error.hpp"
+#include "feed_engine.hpp"
 #include "format.hpp"
 #include "frame.hpp"
+#include "frame_pool.hpp"
+#include "frame_stats.hpp"
 #include "handle.hpp"
 #include "id3.hpp"
+#include "loudness.hpp"
+#include "memory_profile.hpp"
+#include "metadata_cache.hpp"
+#include "mixer.hpp"
+#include "pcm_hash.hpp"
+#include "pcm_stream.hpp"
+#include "pcm_writer.hpp"
+#include "prefetching_decoder.hpp"
+#include "preview.hpp"
+#include "seek.hpp"
+#include "shm_pcm.hpp"
+#include "silence.hpp"
+#include "splicer.hpp"
+#include "stream_decoder.hpp"
+#include "volume.hpp"
+#include "waveform.hpp"
 
 #endif
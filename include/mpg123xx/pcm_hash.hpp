@@ -0,0 +1,181 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_PCM_HASH_HPP
+#define MPG123XX_PCM_HASH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    namespace detail {
+
+        // Streaming XXH64.
+        struct xxh64_state {
+
+            std::uint64_t seed;
+            std::uint64_t acc[4];
+            std::uint64_t total = 0;
+            std::byte buf[32];
+            std::size_t buf_size = 0;
+
+
+            explicit
+            xxh64_state(std::uint64_t seed = 0)
+                noexcept;
+
+            void
+            update(std::span<const std::byte> data)
+                noexcept;
+
+            [[nodiscard]]
+            std::uint64_t
+            digest()
+                const noexcept;
+
+        };
+
+
+        struct sha256_state {
+
+            std::uint32_t h[8];
+            std::uint64_t total = 0;
+            std::byte buf[64];
+            std::size_t buf_size = 0;
+
+
+            sha256_state()
+                noexcept;
+
+            void
+            update(std::span<const std::byte> data)
+                noexcept;
+
+            [[nodiscard]]
+            std::array<std::uint8_t, 32>
+            digest()
+                const noexcept;
+
+        };
+
+    } // namespace detail
+
+
+    struct pcm_digest {
+
+        std::uint64_t xxh64 = 0;
+        std::optional<std::array<std::uint8_t, 32>> sha256;
+        std::intmax_t samples = 0; // per channel
+
+
+        // 16 hex digits of the XXH64.
+        [[nodiscard]]
+        std::string
+        hex()
+            const;
+
+        [[nodiscard]]
+        std::string
+        sha256_hex()
+            const;
+
+
+        bool
+        operator ==(const pcm_digest& other)
+            const noexcept = default;
+
+    }; // struct pcm_digest
+
+
+    // Incremental hash of decoded PCM, fed as it comes out of the decoder. The
+    // rate and channel count are hashed first, so the same samples in another
+    // layout don't collide.
+    class pcm_hasher {
+
+    public:
+
+        pcm_hasher(long rate,
+                   unsigned channels,
+                   bool with_sha256 = false);
+
+
+        // Samples as signed 16-bit, native byte order.
+        void
+        update(std::span<const std::byte> samples);
+
+
+        [[nodiscard]]
+        pcm_digest
+        digest()
+            const;
+
+    private:
+
+        unsigned channels;
+        detail::xxh64_state xxh;
+        std::optional<detail::sha256_state> sha;
+        std::intmax_t samples = 0;
+
+
+        void
+        hash(std::span<const std::byte> data)
+            noexcept;
+
+    }; // class pcm_hasher
+
+
+    // Set the handle up for hashing: signed 16-bit output at the stream's own
+    // rate and channels, gapless trimming on, no RVA. Call before opening.
+    //
+    // Note: the hash covers only the decoded audio, so tags, padding and
+    // container details don't change it. Bit-exact output is only guaranteed
+    // with the same libmpg123 decoder, so compare hashes made with the same one.
+    void
+    configure_for_hash(handle& h);
+
+
+    // Hash the rest of the stream.
+    [[nodiscard]]
+    pcm_digest
+    hash_pcm(handle& h,
+             bool with_sha256 = false);
+
+    [[nodiscard]]
+    pcm_digest
+    hash_pcm(const path& filename,
+             bool with_sha256 = false);
+
+
+    struct pcm_hash_options {
+        bool sha256 = false;
+        unsigned threads = 0; // 0 for one per core
+    };
+
+
+    // Hash many files on a pool of worker threads. Files that can't be decoded
+    // give an empty result.
+    [[nodiscard]]
+    std::vector<std::optional<pcm_digest>>
+    hash_files(std::span<const path> files,
+               const pcm_hash_options& opts = {});
+
+} // namespace mpg123
+
+#endif
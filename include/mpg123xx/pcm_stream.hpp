@@ -0,0 +1,161 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_PCM_STREAM_HPP
+#define MPG123XX_PCM_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "error.hpp"
+#include "format.hpp"
+
+
+namespace mpg123 {
+
+    struct handle;
+
+
+    // Caller-owned output buffer for a handle, big enough for one frame in any
+    // output format (mpg123_safe_buffer()). Once attached, libmpg123 decodes
+    // into it and never allocates its own, not even on a format change.
+    class output_buffer {
+
+    public:
+
+        // Rounded up to mpg123_safe_buffer().
+        explicit
+        output_buffer(std::size_t size = 0);
+
+
+        // Register with the handle; the buffer must outlive the handle's use of it.
+        void
+        attach(handle& h);
+
+        std::expected<void, error>
+        try_attach(handle& h)
+            noexcept;
+
+
+        [[nodiscard]]
+        std::span<std::byte>
+        data()
+            noexcept;
+
+        [[nodiscard]]
+        std::size_t
+        size()
+            const noexcept;
+
+    private:
+
+        std::unique_ptr<std::byte[]> storage;
+        std::size_t capacity;
+
+    }; // class output_buffer
+
+
+    struct pcm_event {
+
+        enum class kind {
+            samples,
+            new_format, // the samples that follow are in fmt
+            need_more,  // feed mode: feed more input and call next() again
+            done,
+        };
+
+        kind type;
+        format fmt; // current output format
+        std::span<const std::byte> samples;
+
+    }; // struct pcm_event
+
+
+    // Decodes frame by frame into an output_buffer, turning MPG123_NEW_FORMAT into
+    // an event instead of an error. Renegotiation only swaps the format the
+    // samples are tagged with; the buffer stays the same. A new_format event is
+    // only reported when the format actually differs from the current one, so the
+    // first is the initial format.
+    //
+    // libmpg123 can't switch a handle back to its own buffer, so the handle keeps
+    // decoding into this one. Don't decode from the handle after its buffer is
+    // gone: either pass an output_buffer that outlives the handle, or stop using
+    // the handle along with the pcm_stream.
+    class pcm_stream {
+
+    public:
+
+        struct options {
+            // 0 for mpg123_safe_buffer(). Unused with a caller's output_buffer.
+            std::size_t buffer_size = 0;
+            // Apply handle::force_format(); the handle must not be open yet.
+            std::optional<format> forced;
+        };
+
+
+        explicit
+        pcm_stream(handle& h);
+
+        pcm_stream(handle& h,
+                   const options& opts);
+
+        // Decode into the caller's buffer, which must stay alive as long as the
+        // handle is decoded from.
+        pcm_stream(handle& h,
+                   output_buffer& buf);
+
+        pcm_stream(handle& h,
+                   output_buffer& buf,
+                   const options& opts);
+
+        pcm_stream(const pcm_stream&) = delete;
+
+
+        // Samples are valid until the next call.
+        pcm_event
+        next();
+
+        std::expected<pcm_event, error>
+        try_next()
+            noexcept;
+
+
+        [[nodiscard]]
+        const std::optional<format>&
+        current_format()
+            const noexcept;
+
+
+        // Changes after the initial format.
+        [[nodiscard]]
+        std::uintmax_t
+        format_changes()
+            const noexcept;
+
+
+        [[nodiscard]]
+        const output_buffer&
+        buffer()
+            const noexcept;
+
+    private:
+
+        handle* h;
+        std::optional<output_buffer> own_buf;
+        output_buffer* buf;
+        std::optional<format> current;
+        std::uintmax_t changes = 0;
+
+    }; // class pcm_stream
+
+} // namespace mpg123
+
+#endif
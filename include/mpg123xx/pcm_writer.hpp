@@ -0,0 +1,169 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_PCM_WRITER_HPP
+#define MPG123XX_PCM_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+#include "format.hpp"
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    // Writes decoded samples to a WAV or raw PCM file, through one large aligned
+    // buffer. The WAV header is only written with the real sizes on close().
+    // Samples are written as decoded, so WAV output assumes little-endian samples.
+    class pcm_writer {
+
+    public:
+
+        enum class container {
+            raw,
+            wav,
+        };
+
+
+        struct options {
+            container type = container::wav;
+            // Must be a multiple of 4096.
+            std::size_t buffer_size = 4 * 1024 * 1024;
+            // Open with O_DIRECT, bypassing the page cache.
+            bool direct = false;
+            // Bytes to reserve on disk up-front; the file is trimmed on close().
+            std::uint64_t preallocate = 0;
+        };
+
+
+        static constexpr std::size_t alignment = 4096;
+
+
+        pcm_writer()
+            noexcept = default;
+
+        pcm_writer(const path& filename,
+                   const format& fmt);
+
+        pcm_writer(const path& filename,
+                   const format& fmt,
+                   const options& opts);
+
+
+        /// Move constructor.
+        pcm_writer(pcm_writer&& other)
+            noexcept;
+
+        /// Move assignment.
+        pcm_writer&
+        operator =(pcm_writer&& other)
+            noexcept;
+
+
+        // Closes the file, ignoring errors; call close() to see them.
+        ~pcm_writer()
+            noexcept;
+
+
+        void
+        open(const path& filename,
+             const format& fmt);
+
+        void
+        open(const path& filename,
+             const format& fmt,
+             const options& opts);
+
+
+        [[nodiscard]]
+        bool
+        is_open()
+            const noexcept;
+
+
+        // Flush the buffer, patch the WAV header and close the file.
+        void
+        close();
+
+
+        void
+        write(const void* buf,
+              std::size_t size);
+
+        template<typename T,
+                 std::size_t E>
+        void
+        write(std::span<const T, E> buf)
+        {
+            write(buf.data(), buf.size_bytes());
+        }
+
+        void
+        write(const frame& f);
+
+
+        // Decode until the end of the stream, reading straight into the buffer.
+        // Returns how many bytes were written.
+        std::uint64_t
+        write_all(handle& h);
+
+
+        // Sample bytes written so far (excluding the WAV header).
+        [[nodiscard]]
+        std::uint64_t
+        size()
+            const noexcept;
+
+
+        [[nodiscard]]
+        const format&
+        get_format()
+            const noexcept;
+
+    private:
+
+        struct aligned_delete {
+            void
+            operator ()(std::byte* p)
+                const noexcept;
+        };
+
+        int fd = -1;
+        format fmt{};
+        options opts{};
+        std::unique_ptr<std::byte[], aligned_delete> buffer;
+        std::size_t fill = 0;
+        std::uint64_t header_size = 0;
+        std::uint64_t data_size = 0;
+
+
+        void
+        flush_full();
+
+        void
+        write_fully(const std::byte* data,
+                    std::size_t size,
+                    std::uint64_t offset);
+
+        void
+        reset()
+            noexcept;
+
+    }; // class pcm_writer
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_PREFETCHING_DECODER_HPP
+#define MPG123XX_PREFETCHING_DECODER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+#include "format.hpp"
+#include "frame_pool.hpp"
+#include "handle.hpp"
+
+
+namespace mpg123 {
+
+    // Owns a handle and decodes ahead of the consumer on a worker thread, into a
+    // bounded queue of preallocated blocks. try_pop() never waits for the disk or
+    // the decoder, so it can be called from a UI or audio thread.
+    class prefetching_decoder {
+
+    public:
+
+        struct options {
+            unsigned lookahead_frames = 32;
+            // If not zero, overrides lookahead_frames, using the stream's frame
+            // duration.
+            unsigned lookahead_ms = 0;
+        };
+
+
+        // The handle must have a stream open; its output format is fixed from
+        // here on. If the stream changes format anyway, decoding stops there with
+        // MPG123_BAD_OUTFORMAT (see get_error()).
+        explicit
+        prefetching_decoder(handle&& source);
+
+        prefetching_decoder(handle&& source,
+                            const options& opts);
+
+        prefetching_decoder(const prefetching_decoder&) = delete;
+
+
+        // Every frame popped from it must be gone by now.
+        ~prefetching_decoder()
+            noexcept;
+
+
+        // Returns nothing if no frame is ready yet. The frame's samples live in
+        // this decoder's frame_pool, so release it before destroying the decoder.
+        [[nodiscard]]
+        std::optional<frame_buffer>
+        try_pop();
+
+
+        // Drop the lookahead and continue decoding from this sample. Frames popped
+        // afterwards all come from the new position.
+        void
+        seek(std::intmax_t sample);
+
+
+        [[nodiscard]]
+        const format&
+        get_format()
+            const noexcept;
+
+
+        // Number of frames the worker keeps ready.
+        [[nodiscard]]
+        std::size_t
+        lookahead()
+            const noexcept;
+
+        // Number of frames ready right now.
+        [[nodiscard]]
+        std::size_t
+        buffered()
+            const;
+
+
+        // True once the stream ended (or failed) and every frame was popped.
+        [[nodiscard]]
+        bool
+        finished()
+            const;
+
+        // Why decoding stopped early, if it did.
+        [[nodiscard]]
+        std::optional<error>
+        get_error()
+            const;
+
+    private:
+
+        void
+        work();
+
+
+        handle h;
+        format fmt;
+        std::size_t capacity;
+        frame_pool pool;
+
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        // Ring of decoded frames; its size is fixed, so nothing allocates after
+        // construction.
+        std::vector<frame_buffer> ring;
+        std::size_t head = 0;
+        std::size_t count = 0;
+        std::optional<std::intmax_t> pending_seek;
+        // Bumped on every seek, to drop frames decoded from the old position.
+        unsigned generation = 0;
+        bool at_end = false;
+        std::optional<error> failure;
+        bool stopping = false;
+
+        // Note: declared last, so the thread is joined before anything else is
+        // destroyed.
+        std::jthread worker;
+
+    }; // class prefetching_decoder
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_PREVIEW_HPP
+#define MPG123XX_PREVIEW_HPP
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+
+#include "error.hpp"
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    // Cheap, low-quality decoding for scrubbing previews and thumbnails.
+    struct preview_options {
+
+        // MPG123_DOWN_SAMPLE: 0 (full rate), 1 (half) or 2 (quarter).
+        int down_sample = 2;
+        // Mix down to mono.
+        bool mono = true;
+        // Float output instead of 8-bit.
+        bool use_float = false;
+
+        // Decode one frame out of every frame_step; the others are only parsed.
+        unsigned frame_step = 8;
+        // Frames decoded and thrown away right before each kept one, so the
+        // synthesis filter and overlap-add state are filled again after a gap.
+        unsigned warm_up = 1;
+
+    }; // struct preview_options
+
+
+    // Apply the output settings from opts. Call before opening.
+    void
+    configure_for_preview(handle& h,
+                          const preview_options& opts);
+
+
+    // Walks the stream in frame-by-frame mode, decoding only every frame_step-th
+    // frame (plus its warm-up frames). Skipped frames are still read and parsed,
+    // so the parser keeps sync and the Layer III bit reservoir stays valid.
+    class preview_decoder {
+
+    public:
+
+        preview_decoder(handle& h,
+                        const preview_options& opts);
+
+
+        // Same as handle::decode_frame(): throws MPG123_DONE at the end.
+        frame
+        next();
+
+        // The next kept frame, or MPG123_DONE / MPG123_NEED_MORE.
+        std::expected<frame, error>
+        try_next()
+            noexcept;
+
+
+        [[nodiscard]]
+        std::uintmax_t
+        frames_seen()
+            const noexcept;
+
+        [[nodiscard]]
+        std::uintmax_t
+        frames_decoded()
+            const noexcept;
+
+    private:
+
+        handle* h;
+        unsigned step;
+        unsigned warm_up;
+        std::uintmax_t seen = 0;
+        std::uintmax_t decoded = 0;
+
+    }; // class preview_decoder
+
+
+    struct preview_report {
+
+        double full_seconds = 0;    // full-quality decode of every frame
+        double preview_seconds = 0;
+        std::uintmax_t frames = 0;
+        std::uintmax_t frames_decoded = 0; // in preview mode
+
+
+        [[nodiscard]]
+        double
+        speedup()
+            const noexcept
+        {
+            return preview_seconds > 0 ? full_seconds / preview_seconds : 0;
+        }
+
+    }; // struct preview_report
+
+
+    // Decode the file twice, once in full and once in preview mode, and time
+    // both.
+    [[nodiscard]]
+    preview_report
+    measure_preview(const path& filename,
+                    const preview_options& opts = {});
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_SEEK_HPP
+#define MPG123XX_SEEK_HPP
+
+#include <cstdint>
+#include <span>
+
+#include <sys/types.h>
+
+
+namespace mpg123 {
+
+    // How libmpg123 finds its way around a stream when seeking.
+    //
+    // The index stores the input offset of every step-th frame. A fixed-size
+    // index doubles its step (dropping every other entry) when it fills up, so
+    // memory stays constant but seeks on long files scan further from the nearest
+    // entry. A growing index keeps every frame, so seeks are exact and quick, at
+    // the cost of one offset per frame (about 300 KiB per hour of audio).
+    struct seek_policy {
+
+        // Number of index entries; 0 disables the index, a negative value lets it
+        // grow in steps of -index_size entries.
+        long index_size = 1000;
+
+        // Guess the position from the Xing/Info TOC instead of scanning frames,
+        // for seeks outside the indexed region. Quick, but not sample-accurate.
+        bool fuzzy = false;
+
+        // Keep a small buffer for peeking ahead while syncing on non-seekable
+        // streams.
+        bool seekbuffer = false;
+
+        // Read the whole stream once after opening, to fill the index and get the
+        // exact length. Only honored by handle::from_file(); otherwise call
+        // handle::scan() after opening.
+        bool prescan = false;
+
+
+        // libmpg123's defaults.
+        [[nodiscard]]
+        static constexpr
+        seek_policy
+        defaults()
+            noexcept
+        {
+            return {};
+        }
+
+
+        [[nodiscard]]
+        static constexpr
+        seek_policy
+        fixed(long entries)
+            noexcept
+        {
+            return { .index_size = entries };
+        }
+
+
+        [[nodiscard]]
+        static constexpr
+        seek_policy
+        growing(long chunk = 1000)
+            noexcept
+        {
+            return { .index_size = -chunk };
+        }
+
+
+        // Jump straight to the TOC's estimate; meant for scrubbing.
+        [[nodiscard]]
+        static constexpr
+        seek_policy
+        fuzzy_toc()
+            noexcept
+        {
+            return { .index_size = 1000, .fuzzy = true };
+        }
+
+
+        // Build a complete index up front; the first seek is as quick as any other.
+        [[nodiscard]]
+        static constexpr
+        seek_policy
+        prescanned()
+            noexcept
+        {
+            return { .index_size = -1000, .prescan = true };
+        }
+
+    }; // struct seek_policy
+
+
+    // A view of the handle's frame index; valid until the next operation on the
+    // handle.
+    struct seek_index {
+
+        std::span<const off_t> offsets; // input offset of every step-th frame
+        std::intmax_t step;             // frames between entries
+
+
+        // Bytes taken by the filled entries.
+        [[nodiscard]]
+        std::size_t
+        memory()
+            const noexcept
+        {
+            return offsets.size_bytes();
+        }
+
+    }; // struct seek_index
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,302 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_SHM_PCM_HPP
+#define MPG123XX_SHM_PCM_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "format.hpp"
+
+
+namespace mpg123 {
+
+    struct handle;
+
+
+    namespace detail {
+
+        struct shm_ring_header;
+
+
+        // The ring's shared memory, mapped in this process. The data area is
+        // mapped twice in a row, so any span of up to capacity bytes starting
+        // inside the ring is contiguous, even across the wrap-around.
+        struct shm_ring_mapping {
+
+            int fd = -1;
+            shm_ring_header* header = nullptr;
+            std::size_t header_size = 0;
+            std::byte* data = nullptr;
+            std::size_t capacity = 0;
+
+
+            shm_ring_mapping()
+                noexcept = default;
+
+            shm_ring_mapping(int fd,
+                             bool writable);
+
+            shm_ring_mapping(shm_ring_mapping&& other)
+                noexcept;
+
+            shm_ring_mapping&
+            operator =(shm_ring_mapping&& other)
+                noexcept;
+
+            ~shm_ring_mapping()
+                noexcept;
+
+            void
+            unmap()
+                noexcept;
+
+        };
+
+    } // namespace detail
+
+
+    // Producer side of a PCM ring in shared memory (POSIX shm or memfd), for
+    // passing decoded audio to other processes without pipes. The segment has a
+    // small header with the write position, the output formats and one cursor
+    // per reader; data moves through atomics only, and waiting is done on futexes
+    // in the segment itself.
+    //
+    // There's a single writer. Unless the ring is lossy, the writer never
+    // overwrites what an attached reader hasn't consumed yet, so the slowest
+    // reader sets the pace. Readers that died without detaching are dropped
+    // while the writer waits for them.
+    class shm_pcm_writer {
+
+    public:
+
+        struct options {
+            // Rounded up to the page size.
+            std::size_t capacity = 4 * 1024 * 1024;
+            unsigned max_readers = 8;
+            // Never wait for readers; the ones that fall behind skip ahead. Only
+            // half the capacity is writable at once, so the other half stays
+            // intact for readers.
+            bool lossy = false;
+        };
+
+
+        shm_pcm_writer()
+            noexcept = default;
+
+
+        // Named constructor: create a POSIX shm segment; name starts with '/'. The
+        // name is unlinked when the writer is destroyed.
+        [[nodiscard]]
+        static
+        shm_pcm_writer
+        create(const std::string& name,
+               const options& opts);
+
+        // Named constructor: create an anonymous memfd segment, to be passed to
+        // readers through fd(), across fork() or over a Unix socket.
+        [[nodiscard]]
+        static
+        shm_pcm_writer
+        create_anonymous(const options& opts);
+
+
+        /// Move constructor.
+        shm_pcm_writer(shm_pcm_writer&& other)
+            noexcept;
+
+        /// Move assignment.
+        shm_pcm_writer&
+        operator =(shm_pcm_writer&& other)
+            noexcept;
+
+
+        // Closes the stream, so readers see its end.
+        ~shm_pcm_writer()
+            noexcept;
+
+
+        // Samples committed from now on are in this format.
+        void
+        set_format(const format& fmt);
+
+
+        // Free space at the write position, possibly empty.
+        [[nodiscard]]
+        std::span<std::byte>
+        writable()
+            noexcept;
+
+        // Wait until at least min_size bytes (up to the capacity, or half of it if
+        // lossy) are free.
+        [[nodiscard]]
+        std::span<std::byte>
+        wait_writable(std::size_t min_size);
+
+        // Publish n bytes written into the span from writable().
+        void
+        commit(std::size_t n);
+
+
+        // Copy into the ring, waiting for space as needed.
+        void
+        write(std::span<const std::byte> data);
+
+
+        // Decode the rest of the stream straight into the ring, then close it.
+        // In feed mode, returns when the handle needs more input instead. Returns
+        // the number of bytes written.
+        std::uint64_t
+        write_all(handle& h);
+
+
+        // No more data; readers get the end of the stream once they've caught up.
+        void
+        close()
+            noexcept;
+
+
+        [[nodiscard]]
+        int
+        fd()
+            const noexcept;
+
+        [[nodiscard]]
+        std::size_t
+        capacity()
+            const noexcept;
+
+        [[nodiscard]]
+        unsigned
+        num_readers()
+            const noexcept;
+
+    private:
+
+        detail::shm_ring_mapping ring;
+        std::string name;
+
+
+        explicit
+        shm_pcm_writer(int fd,
+                       const options& opts,
+                       std::string name);
+
+
+        // Free bytes at the write position, given the slowest reader.
+        std::size_t
+        free_space()
+            const noexcept;
+
+        void
+        drop_dead_readers()
+            noexcept;
+
+    }; // class shm_pcm_writer
+
+
+    // Consumer side of a shm_pcm_writer's ring. Reading starts at the writer's
+    // current position; the samples are read in place, without copying.
+    class shm_pcm_reader {
+
+    public:
+
+        shm_pcm_reader()
+            noexcept = default;
+
+        // Open a POSIX shm segment by name.
+        explicit
+        shm_pcm_reader(const std::string& name);
+
+        // Use a segment received as a file descriptor; fd is duplicated.
+        explicit
+        shm_pcm_reader(int fd);
+
+
+        /// Move constructor.
+        shm_pcm_reader(shm_pcm_reader&& other)
+            noexcept;
+
+        /// Move assignment.
+        shm_pcm_reader&
+        operator =(shm_pcm_reader&& other)
+            noexcept;
+
+
+        // Detaches, so the writer stops waiting for this reader.
+        ~shm_pcm_reader()
+            noexcept;
+
+
+        // PCM at the read position, all in one format (see get_format()), or
+        // empty if there's nothing new.
+        [[nodiscard]]
+        std::span<const std::byte>
+        readable()
+            noexcept;
+
+        // Wait for data, the end of the stream, or the timeout.
+        [[nodiscard]]
+        std::span<const std::byte>
+        wait_readable(std::chrono::milliseconds timeout);
+
+
+        // Move past n bytes of the span from readable(). Returns false if the
+        // writer of a lossy ring overwrote them meanwhile.
+        bool
+        consume(std::size_t n)
+            noexcept;
+
+
+        // Format of the span last returned by readable().
+        [[nodiscard]]
+        format
+        get_format()
+            const noexcept;
+
+        // The writer closed the stream and everything was read.
+        [[nodiscard]]
+        bool
+        eof()
+            const noexcept;
+
+        [[nodiscard]]
+        std::uint64_t
+        position()
+            const noexcept;
+
+        // Bytes skipped because the writer lapped this reader.
+        [[nodiscard]]
+        std::uint64_t
+        dropped()
+            const noexcept;
+
+    private:
+
+        detail::shm_ring_mapping ring;
+        unsigned slot = 0;
+        std::uint64_t pos = 0;
+        std::uint64_t lost = 0;
+        format fmt{};
+
+
+        void
+        attach();
+
+        void
+        detach()
+            noexcept;
+
+    }; // class shm_pcm_reader
+
+} // namespace mpg123
+
+#endif
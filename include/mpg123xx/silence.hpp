@@ -0,0 +1,130 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_SILENCE_HPP
+#define MPG123XX_SILENCE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "format.hpp"
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    struct handle;
+
+
+    // A position in the decoded stream.
+    struct stream_position {
+        std::intmax_t sample;       // in samples per channel
+        std::intmax_t input_offset; // input byte offset of the frame holding it, -1 if unknown
+    };
+
+
+    // Finds the first and last sample above a threshold, in any output encoding,
+    // as the decoded output streams through it. Each chunk is checked in blocks
+    // (which the compiler vectorizes), stopping at the first loud block: from the
+    // front until the first sound is found, and from the back for the last one.
+    class silence_detector {
+
+    public:
+
+        // The threshold is relative to full scale; -60 dB is inaudible in most
+        // material.
+        explicit
+        silence_detector(const format& fmt,
+                         double threshold_db = -60.0);
+
+
+        // Process the next chunk of decoded output. input_offset is reported back
+        // for positions found in this chunk. Returns true if the chunk isn't
+        // silent.
+        bool
+        process(std::span<const std::byte> samples,
+                std::intmax_t input_offset = -1);
+
+
+        // Restart counting from this sample, after the handle seeks.
+        void
+        set_position(std::intmax_t sample)
+            noexcept;
+
+        [[nodiscard]]
+        std::intmax_t
+        position()
+            const noexcept;
+
+
+        // First sample above the threshold.
+        [[nodiscard]]
+        const std::optional<stream_position>&
+        first_sound()
+            const noexcept;
+
+        // Last sample above the threshold.
+        [[nodiscard]]
+        const std::optional<stream_position>&
+        last_sound()
+            const noexcept;
+
+
+        void
+        reset()
+            noexcept;
+
+    private:
+
+        format fmt;
+        unsigned bytes_per_sample;
+        // Threshold scaled to the encoding.
+        double threshold;
+        std::int64_t int_threshold;
+        // For 8-bit encodings: whether each byte value is above the threshold.
+        std::array<bool, 256> loud_byte{};
+
+        std::intmax_t pos = 0;
+        std::optional<stream_position> first;
+        std::optional<stream_position> last;
+
+
+        // Index of the first/last loud value in the chunk, or -1.
+        std::ptrdiff_t
+        find_first(std::span<const std::byte> samples)
+            const noexcept;
+
+        std::ptrdiff_t
+        find_last(std::span<const std::byte> samples)
+            const noexcept;
+
+    }; // class silence_detector
+
+
+    struct silence_bounds {
+        // Both are empty if the whole stream is silent.
+        std::optional<stream_position> first_sound;
+        std::optional<stream_position> last_sound;
+        std::intmax_t length; // total samples
+    };
+
+
+    // Find where the sound starts and ends in an opened stream. The start is
+    // found by decoding from the beginning until the first loud sample; the end by
+    // seeking to the last tail_seconds and decoding only from there, extending
+    // the tail while it's all silent. Leaves the handle at the end of the stream.
+    silence_bounds
+    find_silence_bounds(handle& h,
+                        double threshold_db = -60.0,
+                        double tail_seconds = 10.0);
+
+} // namespace mpg123
+
+#endif
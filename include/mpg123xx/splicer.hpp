@@ -0,0 +1,116 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_SPLICER_HPP
+#define MPG123XX_SPLICER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "frame.hpp"
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+    struct handle;
+
+
+    // Copies ranges of MPEG frames into a new file, without decoding them. For
+    // Layer III, an Info/Xing frame with the new frame count, size and seek table
+    // is written at the start of the file on close().
+    // Note: the first frame of a range may use bit reservoir data from a frame that
+    // was not copied, so a decoder may glitch for one frame after each cut.
+    class splicer {
+
+    public:
+
+        splicer() = default;
+
+        explicit
+        splicer(const path& filename);
+
+
+        /// Move constructor.
+        splicer(splicer&& other)
+            noexcept = default;
+
+        /// Move assignment.
+        splicer&
+        operator =(splicer&& other)
+            noexcept = default;
+
+
+        // Closes the file, ignoring errors; call close() to see them.
+        ~splicer()
+            noexcept;
+
+
+        void
+        open(const path& filename);
+
+
+        [[nodiscard]]
+        bool
+        is_open()
+            const noexcept;
+
+
+        // Write the Info/Xing frame and close the file.
+        void
+        close();
+
+
+        // Copy frames [first, last) of the input file; a negative last means
+        // until the end. Returns how many frames were copied.
+        std::uintmax_t
+        append(const path& input,
+               std::intmax_t first,
+               std::intmax_t last = -1);
+
+
+        // Copy up to count frames from a handle, starting with the next frame.
+        // Returns how many frames were copied.
+        std::uintmax_t
+        append(handle& h,
+               std::uintmax_t count);
+
+
+        void
+        append(const raw_frame& f);
+
+
+        [[nodiscard]]
+        std::uintmax_t
+        frames()
+            const noexcept;
+
+
+        // Bytes written, including the Info/Xing frame.
+        [[nodiscard]]
+        std::uintmax_t
+        bytes()
+            const noexcept;
+
+    private:
+
+        std::ofstream out;
+        std::uint32_t first_header = 0;
+        std::uint64_t tag_size = 0;
+        std::uint64_t size = 0;
+        bool vbr = false;
+        // Output position of each frame, for the seek table.
+        std::vector<std::uint64_t> offsets;
+
+    }; // class splicer
+
+} // namespace mpg123
+
+#endif
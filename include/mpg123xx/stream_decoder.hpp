@@ -0,0 +1,174 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_STREAM_DECODER_HPP
+#define MPG123XX_STREAM_DECODER_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+
+#include "error.hpp"
+#include "format.hpp"
+
+
+namespace mpg123 {
+
+    struct handle;
+
+
+    // Where suspended coroutines are resumed. Implement post() to plug in any
+    // event loop or thread pool.
+    class executor {
+
+    public:
+
+        virtual
+        ~executor()
+            noexcept = default;
+
+        // Resume h later, on the executor's thread(s). Called from any thread.
+        virtual
+        void
+        post(std::coroutine_handle<> h) = 0;
+
+    }; // class executor
+
+
+    // Single-threaded executor: coroutines are resumed by whoever calls run().
+    class run_loop : public executor {
+
+    public:
+
+        void
+        post(std::coroutine_handle<> h)
+            override;
+
+
+        // Resume posted coroutines until stop() is called.
+        void
+        run();
+
+        // Resume the coroutines posted so far, without waiting. Returns how many
+        // were resumed.
+        std::size_t
+        run_pending();
+
+        // Make run() return once the current coroutine suspends, and any later
+        // run() return right away; thread-safe.
+        void
+        stop();
+
+    private:
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<std::coroutine_handle<>> queue;
+        bool stopped = false;
+
+    }; // class run_loop
+
+
+    // Coroutine interface to a handle in feed mode. The producer feeds input
+    // from any thread; the consumer does co_await next_block(), which suspends
+    // while the handle needs more input and resumes, through the executor, once
+    // enough was fed to decode more.
+    class stream_decoder {
+
+    public:
+
+        class next_block_awaiter {
+
+        public:
+
+            bool
+            await_ready();
+
+            bool
+            await_suspend(std::coroutine_handle<> h);
+
+            // Empty at the end of the stream; throws mpg123::error on decoding
+            // errors.
+            std::span<const std::byte>
+            await_resume();
+
+        private:
+
+            friend class stream_decoder;
+
+            stream_decoder* decoder;
+            std::coroutine_handle<> waiter;
+            std::span<const std::byte> pcm;
+            std::optional<error> failure;
+
+
+            explicit
+            next_block_awaiter(stream_decoder* decoder)
+                noexcept;
+
+        }; // class next_block_awaiter
+
+
+        // Puts the handle in feed mode. The handle must outlive this object, and
+        // only this object should touch it from now on.
+        stream_decoder(handle& h,
+                       executor& ex,
+                       std::size_t block_size = 32 * 1024);
+
+        stream_decoder(const stream_decoder&) = delete;
+
+
+        // Add input; thread-safe. Throws mpg123::error if the handle rejects it.
+        void
+        feed(std::span<const std::byte> data);
+
+        // No more input; the consumer gets what's left, then the end of the
+        // stream. Thread-safe.
+        void
+        close();
+
+
+        // Decoded PCM, at most block_size bytes, valid until the next call. Only
+        // one coroutine may wait at a time.
+        [[nodiscard]]
+        next_block_awaiter
+        next_block()
+            noexcept;
+
+
+        // Format of the last block.
+        [[nodiscard]]
+        format
+        get_format();
+
+    private:
+
+        handle* h;
+        executor* ex;
+        std::size_t block_size;
+        std::unique_ptr<std::byte[]> buf;
+        format fmt{};
+
+        std::mutex mutex;
+        bool eof = false;
+        next_block_awaiter* waiting = nullptr;
+
+
+        // Try to produce the awaiter's result; false if more input is needed.
+        bool
+        advance(next_block_awaiter& w);
+
+    }; // class stream_decoder
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_VOLUME_HPP
+#define MPG123XX_VOLUME_HPP
+
+#include <array>
+
+
+namespace mpg123 {
+
+    struct volume {
+        double base;   // as set with handle::set_volume()
+        double really; // applied in the synthesis, including RVA
+        double rva_db; // RVA adjustment, in dB
+    };
+
+
+    inline constexpr int eq_bands = 32;
+
+
+    // Linear factors for each equalizer band; 1.0 is flat.
+    struct equalizer {
+
+        std::array<double, eq_bands> left;
+        std::array<double, eq_bands> right;
+
+
+        constexpr
+        equalizer()
+            noexcept
+        {
+            left.fill(1.0);
+            right.fill(1.0);
+        }
+
+    }; // struct equalizer
+
+} // namespace mpg123
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef MPG123XX_WAVEFORM_HPP
+#define MPG123XX_WAVEFORM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+
+namespace mpg123 {
+
+    using std::filesystem::path;
+
+
+    struct waveform_options {
+
+        // Samples (per channel, at the stream's rate) in each bucket of the finest
+        // level.
+        std::uint32_t samples_per_bucket = 256;
+
+        // Number of zoom levels; each one merges zoom_factor buckets of the
+        // previous level.
+        unsigned levels = 4;
+        unsigned zoom_factor = 4;
+
+        // Previews: mix to mono and/or decode at 1/2^down_sample of the rate,
+        // inside the synthesis. The peaks drop by whatever was in the skipped
+        // channel difference and upper band, but decoding gets much cheaper (see
+        // examples/waveform_bench).
+        bool mono = false;
+        int down_sample = 0;
+
+        // Worker threads, 0 for one per core. Multiple threads are only used when
+        // the file can be indexed up front, to seek each worker to its part.
+        unsigned threads = 1;
+
+
+        [[nodiscard]]
+        static constexpr
+        waveform_options
+        precise()
+            noexcept
+        {
+            return {};
+        }
+
+
+        [[nodiscard]]
+        static constexpr
+        waveform_options
+        fast_preview()
+            noexcept
+        {
+            return { .mono = true, .down_sample = 2 };
+        }
+
+    }; // struct waveform_options
+
+
+    // Range of the samples in one bucket, over all channels, in units of 1/32767
+    // of full scale.
+    struct waveform_bucket {
+        std::int16_t min;
+        std::int16_t max;
+        std::int16_t rms;
+    };
+
+
+    struct waveform_level {
+        std::uint64_t samples_per_bucket; // at the stream's rate
+        std::span<const waveform_bucket> buckets;
+    };
+
+
+    // Multi-resolution peak overview of a stream. The data is kept in the same
+    // layout as the file written by save(), so a saved waveform is used straight
+    // from a read-only mapping.
+    class waveform {
+
+    public:
+
+        waveform()
+            noexcept = default;
+
+        // Map a file written by save(). Throws std::runtime_error if the file
+        // isn't a valid waveform.
+        explicit
+        waveform(const path& filename);
+
+
+        /// Move constructor.
+        waveform(waveform&& other)
+            noexcept;
+
+        /// Move assignment.
+        waveform&
+        operator =(waveform&& other)
+            noexcept;
+
+
+        ~waveform()
+            noexcept;
+
+
+        // Decode the file and build all levels.
+        [[nodiscard]]
+        static
+        waveform
+        generate(const path& filename,
+                 const waveform_options& opts = {});
+
+
+        // Written to a temporary file, then renamed over filename.
+        void
+        save(const path& filename)
+            const;
+
+
+        // The stream's rate, not the decoded one.
+        [[nodiscard]]
+        long
+        rate()
+            const noexcept;
+
+        // In samples per channel, at the stream's rate.
+        [[nodiscard]]
+        std::intmax_t
+        length()
+            const noexcept;
+
+
+        // True if made with a mono or down-sampled preview.
+        [[nodiscard]]
+        bool
+        is_preview()
+            const noexcept;
+
+
+        [[nodiscard]]
+        unsigned
+        num_levels()
+            const noexcept;
+
+        // Level 0 is the finest.
+        [[nodiscard]]
+        waveform_level
+        level(unsigned index)
+            const;
+
+
+        // The whole image, as save() writes it.
+        [[nodiscard]]
+        std::span<const std::byte>
+        data()
+            const noexcept;
+
+    private:
+
+        std::vector<std::byte> owned;
+        const std::byte* base = nullptr;
+        std::size_t size = 0;
+        bool mapped = false;
+
+
+        void
+        close()
+            noexcept;
+
+    }; // class waveform
+
+} // namespace mpg123
+
+#endif
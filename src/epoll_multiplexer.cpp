@@ -0,0 +1,442 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "mpg123xx/epoll_multiplexer.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        [[noreturn]]
+        void
+        throw_errno(const char* what)
+        {
+            throw std::system_error{errno, std::generic_category(), what};
+        }
+
+    } // namespace
+
+
+    struct epoll_multiplexer::impl {
+
+        struct stream {
+            int fd = -1;
+            handle* h = nullptr;
+            data_callback on_data;
+            done_callback on_done;
+            std::unique_ptr<std::byte[]> pcm;
+            // PCM decoded but not yet taken by the callback.
+            std::size_t pcm_begin = 0;
+            std::size_t pcm_end = 0;
+            bool reading = true;
+            bool paused = false;
+            bool eof = false;
+            // Finished or removed; erased after the current batch of events.
+            bool dead = false;
+        };
+
+
+        options opts;
+        int epfd = -1;
+        // Wakes up epoll_wait() when another thread calls resume().
+        int wakefd = -1;
+        std::unordered_map<int, std::unique_ptr<stream>> streams;
+        // Removed streams whose descriptor was added again; one of their callbacks
+        // may still be running.
+        std::vector<std::unique_ptr<stream>> graveyard;
+        std::unique_ptr<std::byte[]> read_buf;
+        std::vector<epoll_event> events;
+        std::size_t num_paused = 0;
+
+        std::mutex resume_mutex;
+        std::vector<int> resumed;
+        std::vector<int> resumed_now;
+
+
+        explicit
+        impl(const options& opts) :
+            opts{opts},
+            read_buf{std::make_unique<std::byte[]>(opts.read_size)},
+            events(std::max(opts.max_events, 1u))
+        {
+            epfd = ::epoll_create1(EPOLL_CLOEXEC);
+            if (epfd < 0)
+                throw_errno("epoll_create1()");
+            wakefd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (wakefd < 0) {
+                int e = errno;
+                ::close(epfd);
+                throw std::system_error{e, std::generic_category(), "eventfd()"};
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = wakefd;
+            if (::epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) < 0) {
+                int e = errno;
+                ::close(wakefd);
+                ::close(epfd);
+                throw std::system_error{e, std::generic_category(), "epoll_ctl()"};
+            }
+        }
+
+
+        ~impl()
+            noexcept
+        {
+            ::close(wakefd);
+            ::close(epfd);
+        }
+
+
+        stream*
+        find(int fd)
+            noexcept
+        {
+            auto it = streams.find(fd);
+            if (it == streams.end() || it->second->dead)
+                return nullptr;
+            return it->second.get();
+        }
+
+
+        // Note: a descriptor is taken out of the epoll set instead of waiting for
+        // no events, since EPOLLHUP is reported regardless.
+        void
+        set_reading(stream& s,
+                    bool enable)
+        {
+            if (s.reading == enable)
+                return;
+            if (enable) {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = s.fd;
+                if (::epoll_ctl(epfd, EPOLL_CTL_ADD, s.fd, &ev) < 0)
+                    throw_errno("epoll_ctl()");
+            } else
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, s.fd, nullptr);
+            s.reading = enable;
+        }
+
+
+        void
+        set_paused(stream& s,
+                   bool p)
+        {
+            if (s.paused == p)
+                return;
+            s.paused = p;
+            if (p)
+                ++num_paused;
+            else
+                --num_paused;
+        }
+
+
+        void
+        finish(stream& s,
+               std::exception_ptr error)
+            noexcept
+        {
+            if (s.dead)
+                return;
+            if (s.reading)
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, s.fd, nullptr);
+            set_paused(s, false);
+            s.dead = true;
+            if (s.on_done) {
+                try {
+                    s.on_done(*s.h, error);
+                }
+                catch (...) {}
+            }
+        }
+
+
+        // Offer the pending PCM, then decode and offer more, until the callback
+        // stops taking it or the handle needs more input.
+        void
+        drain(stream& s)
+        {
+            while (!s.dead) {
+                if (s.pcm_begin < s.pcm_end) {
+                    std::span pending{s.pcm.get() + s.pcm_begin, s.pcm_end - s.pcm_begin};
+                    std::size_t taken = std::min(s.on_data(*s.h, pending), pending.size());
+                    s.pcm_begin += taken;
+                    if (s.pcm_begin < s.pcm_end) {
+                        set_paused(s, true);
+                        set_reading(s, false);
+                        return;
+                    }
+                }
+                set_paused(s, false);
+
+                auto r = s.h->try_read(s.pcm.get(), opts.pcm_size);
+                if (r) {
+                    s.pcm_begin = 0;
+                    s.pcm_end = *r;
+                    if (*r)
+                        continue;
+                    // Nothing decoded: same as needing more input.
+                } else {
+                    switch (r.error().code) {
+                        case MPG123_NEW_FORMAT:
+                            continue;
+                        case MPG123_NEED_MORE:
+                            break;
+                        case MPG123_DONE:
+                            finish(s, nullptr);
+                            return;
+                        default:
+                            finish(s, std::make_exception_ptr(r.error()));
+                            return;
+                    }
+                }
+                if (s.eof)
+                    finish(s, nullptr);
+                else
+                    set_reading(s, true);
+                return;
+            }
+        }
+
+
+        void
+        readable(stream& s)
+        {
+            ssize_t n = ::read(s.fd, read_buf.get(), opts.read_size);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    return;
+                finish(s,
+                       std::make_exception_ptr(std::system_error{errno,
+                                                                 std::generic_category(),
+                                                                 "read()"}));
+                return;
+            }
+            if (n == 0)
+                s.eof = true;
+            else if (auto r = s.h->try_feed(read_buf.get(), n); !r) {
+                finish(s, std::make_exception_ptr(r.error()));
+                return;
+            }
+            drain(s);
+        }
+
+
+        void
+        dispatch(stream& s)
+        {
+            try {
+                if (s.paused)
+                    drain(s);
+                else
+                    readable(s);
+            }
+            catch (...) {
+                finish(s, std::current_exception());
+            }
+        }
+
+
+        void
+        process_resumed()
+        {
+            std::uint64_t counter;
+            [[maybe_unused]] auto n = ::read(wakefd, &counter, sizeof counter);
+            {
+                std::lock_guard lock{resume_mutex};
+                std::swap(resumed, resumed_now);
+            }
+            for (int fd : resumed_now)
+                if (auto s = find(fd); s && s->paused)
+                    dispatch(*s);
+            resumed_now.clear();
+        }
+
+
+        void
+        collect()
+        {
+            graveyard.clear();
+            std::erase_if(streams,
+                          [](auto& entry) -> bool
+                          {
+                              return entry.second->dead;
+                          });
+        }
+
+
+        bool
+        run_once(int timeout_ms)
+        {
+            collect();
+            if (streams.empty())
+                return false;
+
+            int n = ::epoll_wait(epfd, events.data(), events.size(), timeout_ms);
+            if (n < 0) {
+                if (errno == EINTR)
+                    return true;
+                throw_errno("epoll_wait()");
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wakefd) {
+                    process_resumed();
+                    continue;
+                }
+                // Note: the stream may have been removed by an earlier callback.
+                if (auto s = find(fd); s && !s->paused)
+                    dispatch(*s);
+            }
+
+            collect();
+            return !streams.empty();
+        }
+
+    }; // struct epoll_multiplexer::impl
+
+
+    epoll_multiplexer::epoll_multiplexer() :
+        epoll_multiplexer{options{}}
+    {}
+
+
+    epoll_multiplexer::epoll_multiplexer(const options& opts) :
+        pimpl{std::make_unique<impl>(opts)}
+    {}
+
+
+    epoll_multiplexer::epoll_multiplexer(epoll_multiplexer&& other)
+        noexcept = default;
+
+
+    epoll_multiplexer&
+    epoll_multiplexer::operator =(epoll_multiplexer&& other)
+        noexcept = default;
+
+
+    epoll_multiplexer::~epoll_multiplexer()
+        noexcept = default;
+
+
+    epoll_multiplexer::stream_id
+    epoll_multiplexer::add(int fd,
+                           handle& h,
+                           data_callback on_data,
+                           done_callback on_done)
+    {
+        if (pimpl->find(fd))
+            throw std::system_error{EEXIST, std::generic_category(), "epoll_multiplexer::add()"};
+
+        int flags = ::fcntl(fd, F_GETFL);
+        if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+            throw_errno("fcntl()");
+
+        h.open_feed();
+
+        auto s = std::make_unique<impl::stream>();
+        s->fd = fd;
+        s->h = &h;
+        s->on_data = std::move(on_data);
+        s->on_done = std::move(on_done);
+        s->pcm = std::make_unique<std::byte[]>(pimpl->opts.pcm_size);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(pimpl->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            throw_errno("epoll_ctl()");
+
+        // A removed stream with the same descriptor may still be waiting for
+        // collect(), and this may be running from its callback; keep it alive
+        // until then.
+        auto& entry = pimpl->streams[fd];
+        if (entry)
+            pimpl->graveyard.push_back(std::move(entry));
+        entry = std::move(s);
+        return fd;
+    }
+
+
+    void
+    epoll_multiplexer::remove(stream_id id)
+    {
+        if (auto s = pimpl->find(id)) {
+            if (s->reading)
+                ::epoll_ctl(pimpl->epfd, EPOLL_CTL_DEL, s->fd, nullptr);
+            pimpl->set_paused(*s, false);
+            s->dead = true;
+        }
+    }
+
+
+    void
+    epoll_multiplexer::resume(stream_id id)
+    {
+        {
+            std::lock_guard lock{pimpl->resume_mutex};
+            pimpl->resumed.push_back(id);
+        }
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(pimpl->wakefd, &one, sizeof one);
+    }
+
+
+    void
+    epoll_multiplexer::run()
+    {
+        while (run_once())
+            ;
+    }
+
+
+    bool
+    epoll_multiplexer::run_once(int timeout_ms)
+    {
+        return pimpl->run_once(timeout_ms);
+    }
+
+
+    std::size_t
+    epoll_multiplexer::active()
+        const noexcept
+    {
+        return std::ranges::count_if(pimpl->streams,
+                                     [](auto& entry)
+                                     {
+                                         return !entry.second->dead;
+                                     });
+    }
+
+
+    std::size_t
+    epoll_multiplexer::paused()
+        const noexcept
+    {
+        return pimpl->num_paused;
+    }
+
+} // namespace mpg123
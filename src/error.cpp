@@ -14,13 +14,25 @@
 
 namespace mpg123 {
 
-    error::error(int code) :
-        std::runtime_error{mpg123_plain_strerror(code)}
+    error::error(int code)
+        noexcept :
+        code{code},
+        message{mpg123_plain_strerror(code)}
     {}
 
 
-    error::error(const handle* h) :
-        std::runtime_error{mpg123_strerror(const_cast<mpg123_handle*>(h->data()))}
+    error::error(const handle* h)
+        noexcept :
+        code{mpg123_errcode(const_cast<mpg123_handle*>(h->data()))},
+        message{mpg123_plain_strerror(code)}
     {}
 
+
+    const char*
+    error::what()
+        const noexcept
+    {
+        return message;
+    }
+
 } // namespace mpg123
@@ -0,0 +1,524 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "mpg123xx/feed_engine.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        struct read_request {
+            int fd;
+            std::byte* buf;
+            std::size_t size;
+            std::uint64_t offset;
+            void* user;
+            long result = 0; // bytes read, or -errno
+        };
+
+
+        struct backend {
+
+            virtual
+            ~backend()
+                noexcept = default;
+
+            virtual
+            void
+            submit(read_request* req) = 0;
+
+            // Block until at least one request completes; append completed requests.
+            virtual
+            void
+            wait(std::vector<read_request*>& done) = 0;
+
+        }; // struct backend
+
+
+#ifdef HAVE_LIBURING
+
+        class uring_backend : public backend {
+
+            io_uring ring;
+
+        public:
+
+            explicit
+            uring_backend(unsigned depth)
+            {
+                int e = io_uring_queue_init(depth, &ring, 0);
+                if (e < 0)
+                    throw std::system_error{-e, std::generic_category(), "io_uring_queue_init()"};
+            }
+
+
+            ~uring_backend()
+                noexcept override
+            {
+                io_uring_queue_exit(&ring);
+            }
+
+
+            void
+            submit(read_request* req)
+                override
+            {
+                io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+                if (!sqe) {
+                    // Submission queue is full, push it to the kernel and retry.
+                    io_uring_submit(&ring);
+                    sqe = io_uring_get_sqe(&ring);
+                }
+                io_uring_prep_read(sqe, req->fd, req->buf, req->size, req->offset);
+                io_uring_sqe_set_data(sqe, req);
+            }
+
+
+            void
+            wait(std::vector<read_request*>& done)
+                override
+            {
+                int e;
+                do
+                    e = io_uring_submit_and_wait(&ring, 1);
+                while (e == -EINTR);
+                if (e < 0)
+                    throw std::system_error{-e, std::generic_category(), "io_uring_submit_and_wait()"};
+
+                unsigned head;
+                unsigned count = 0;
+                io_uring_cqe* cqe;
+                io_uring_for_each_cqe(&ring, head, cqe) {
+                    auto req = static_cast<read_request*>(io_uring_cqe_get_data(cqe));
+                    req->result = cqe->res;
+                    done.push_back(req);
+                    ++count;
+                }
+                io_uring_cq_advance(&ring, count);
+            }
+
+        }; // class uring_backend
+
+#endif // HAVE_LIBURING
+
+
+        class pool_backend : public backend {
+
+            std::mutex mutex;
+            std::condition_variable work_cv;
+            std::condition_variable done_cv;
+            std::deque<read_request*> todo;
+            std::vector<read_request*> finished;
+            bool stopping = false;
+            // Note: declared last, so the threads are joined before anything else
+            // is destroyed.
+            std::vector<std::jthread> workers;
+
+
+            void
+            work()
+            {
+                std::unique_lock lock{mutex};
+                for (;;) {
+                    work_cv.wait(lock, [this] { return stopping || !todo.empty(); });
+                    if (stopping)
+                        return;
+                    auto req = todo.front();
+                    todo.pop_front();
+                    lock.unlock();
+
+                    ssize_t n;
+                    do
+                        n = ::pread(req->fd, req->buf, req->size, req->offset);
+                    while (n < 0 && errno == EINTR);
+                    req->result = n < 0 ? -errno : n;
+
+                    lock.lock();
+                    finished.push_back(req);
+                    done_cv.notify_one();
+                }
+            }
+
+        public:
+
+            explicit
+            pool_backend(unsigned threads)
+            {
+                threads = std::max(threads, 1u);
+                for (unsigned i = 0; i < threads; ++i)
+                    workers.emplace_back([this] { work(); });
+            }
+
+
+            ~pool_backend()
+                noexcept override
+            {
+                {
+                    std::lock_guard lock{mutex};
+                    stopping = true;
+                }
+                work_cv.notify_all();
+            }
+
+
+            void
+            submit(read_request* req)
+                override
+            {
+                {
+                    std::lock_guard lock{mutex};
+                    todo.push_back(req);
+                }
+                work_cv.notify_one();
+            }
+
+
+            void
+            wait(std::vector<read_request*>& done)
+                override
+            {
+                std::unique_lock lock{mutex};
+                done_cv.wait(lock, [this] { return !finished.empty(); });
+                done.insert(done.end(), finished.begin(), finished.end());
+                finished.clear();
+            }
+
+        }; // class pool_backend
+
+    } // namespace
+
+
+    struct feed_engine::impl {
+
+        struct stream {
+            int fd = -1;
+            handle* h = nullptr;
+            data_callback on_data;
+            done_callback on_done;
+            std::unique_ptr<std::byte[]> memory;
+            std::vector<read_request> slots;
+            // Submitted reads, in file order; they must be fed in this order.
+            std::deque<read_request*> order;
+            std::vector<bool> ready;
+            std::uint64_t next_offset = 0;
+            unsigned in_flight = 0;
+            bool eof = false;
+            std::exception_ptr failure;
+
+
+            ~stream()
+                noexcept
+            {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+
+        }; // struct stream
+
+
+        options opts;
+        std::unique_ptr<backend> io;
+        bool uring = false;
+        std::vector<std::unique_ptr<stream>> streams;
+        // Reads waiting for room in the queue.
+        std::deque<read_request*> waiting;
+        unsigned in_flight = 0;
+        std::vector<read_request*> completed;
+
+
+        explicit
+        impl(const options& opts) :
+            opts{opts}
+        {
+#ifdef HAVE_LIBURING
+            if (opts.use_io_uring) {
+                try {
+                    io = std::make_unique<uring_backend>(opts.queue_depth);
+                    uring = true;
+                }
+                catch (std::system_error&) {
+                    // Kernel too old, or io_uring is disabled; use the thread pool.
+                }
+            }
+#endif
+            if (!io)
+                io = std::make_unique<pool_backend>(opts.threads);
+            completed.reserve(opts.queue_depth);
+        }
+
+
+        void
+        queue_read(stream& s,
+                   read_request& req)
+        {
+            req.offset = s.next_offset;
+            s.next_offset += req.size;
+            s.ready[&req - s.slots.data()] = false;
+            s.order.push_back(&req);
+            ++s.in_flight;
+            waiting.push_back(&req);
+        }
+
+
+        void
+        submit_waiting()
+        {
+            while (!waiting.empty() && in_flight < opts.queue_depth) {
+                io->submit(waiting.front());
+                waiting.pop_front();
+                ++in_flight;
+            }
+        }
+
+
+        void
+        fail(stream& s,
+             std::exception_ptr e)
+            noexcept
+        {
+            if (!s.failure)
+                s.failure = e;
+            s.eof = true;
+        }
+
+
+        // Decode everything that the fed data allows.
+        void
+        drain(stream& s)
+        {
+            while (!s.failure) {
+                auto f = s.h->try_decode_frame();
+                if (f) {
+                    if (!f->samples.empty())
+                        s.on_data(*s.h, *f);
+                    continue;
+                }
+                switch (f.error().code) {
+                    case MPG123_NEW_FORMAT:
+                        continue;
+                    case MPG123_NEED_MORE:
+                        return;
+                    case MPG123_DONE:
+                        s.eof = true;
+                        return;
+                    default:
+                        fail(s, std::make_exception_ptr(f.error()));
+                }
+            }
+        }
+
+
+        void
+        complete(read_request* req)
+        {
+            auto& s = *static_cast<stream*>(req->user);
+            --in_flight;
+            --s.in_flight;
+            s.ready[req - s.slots.data()] = true;
+
+            // Feed the completed reads that are next in file order.
+            while (!s.order.empty() && s.ready[s.order.front() - s.slots.data()]) {
+                auto& r = *s.order.front();
+                s.order.pop_front();
+                if (s.failure)
+                    continue;
+                if (r.result < 0) {
+                    fail(s,
+                         std::make_exception_ptr(std::system_error{int(-r.result),
+                                                                   std::generic_category(),
+                                                                   "read()"}));
+                    continue;
+                }
+                if (s.eof)
+                    continue;
+                if (static_cast<std::size_t>(r.result) < r.size)
+                    s.eof = true;
+                try {
+                    if (r.result > 0) {
+                        s.h->feed(r.buf, r.result);
+                        drain(s);
+                    }
+                }
+                catch (...) {
+                    fail(s, std::current_exception());
+                }
+                if (!s.eof)
+                    queue_read(s, r);
+            }
+        }
+
+
+        void
+        finish(stream& s)
+            noexcept
+        {
+            if (!s.on_done)
+                return;
+            try {
+                s.on_done(*s.h, s.failure);
+            }
+            catch (...) {}
+        }
+
+
+        bool
+        run_once()
+        {
+            if (streams.empty())
+                return false;
+
+            submit_waiting();
+            completed.clear();
+            if (in_flight)
+                io->wait(completed);
+            for (auto req : completed)
+                complete(req);
+
+            std::erase_if(streams,
+                          [this](std::unique_ptr<stream>& s) -> bool
+                          {
+                              if (!s->eof || s->in_flight)
+                                  return false;
+                              finish(*s);
+                              return true;
+                          });
+            return !streams.empty();
+        }
+
+    }; // struct feed_engine::impl
+
+
+    feed_engine::feed_engine() :
+        feed_engine{options{}}
+    {}
+
+
+    feed_engine::feed_engine(const options& opts) :
+        pimpl{std::make_unique<impl>(opts)}
+    {}
+
+
+    feed_engine::feed_engine(feed_engine&& other)
+        noexcept = default;
+
+
+    feed_engine&
+    feed_engine::operator =(feed_engine&& other)
+        noexcept = default;
+
+
+    feed_engine::~feed_engine()
+        noexcept
+    {
+        // Outstanding reads point into the streams' buffers; wait for them.
+        if (pimpl)
+            while (pimpl->in_flight) {
+                pimpl->completed.clear();
+                try {
+                    pimpl->io->wait(pimpl->completed);
+                }
+                catch (...) {
+                    break;
+                }
+                pimpl->in_flight -= pimpl->completed.size();
+            }
+    }
+
+
+    void
+    feed_engine::add(const path& filename,
+                     handle& h,
+                     data_callback on_data,
+                     done_callback on_done)
+    {
+        auto s = std::make_unique<impl::stream>();
+        s->fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (s->fd < 0)
+            throw std::system_error{errno, std::generic_category(), "open()"};
+        ::posix_fadvise(s->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        h.open_feed();
+        s->h = &h;
+        s->on_data = std::move(on_data);
+        s->on_done = std::move(on_done);
+
+        const auto& opts = pimpl->opts;
+        const unsigned count = std::max(opts.reads_per_stream, 1u);
+        s->memory = std::make_unique<std::byte[]>(count * opts.read_size);
+        s->slots.resize(count);
+        s->ready.resize(count);
+        for (unsigned i = 0; i < count; ++i) {
+            auto& req = s->slots[i];
+            req.fd = s->fd;
+            req.buf = s->memory.get() + i * opts.read_size;
+            req.size = opts.read_size;
+            req.user = s.get();
+        }
+
+        auto& ref = *s;
+        pimpl->streams.push_back(std::move(s));
+        for (auto& req : ref.slots)
+            pimpl->queue_read(ref, req);
+    }
+
+
+    void
+    feed_engine::run()
+    {
+        while (pimpl->run_once())
+            ;
+    }
+
+
+    bool
+    feed_engine::run_once()
+    {
+        return pimpl->run_once();
+    }
+
+
+    std::size_t
+    feed_engine::active()
+        const noexcept
+    {
+        return pimpl->streams.size();
+    }
+
+
+    bool
+    feed_engine::using_io_uring()
+        const noexcept
+    {
+        return pimpl->uring;
+    }
+
+} // namespace mpg123
@@ -8,6 +8,8 @@
 #include <ostream>
 #include <sstream>
 
+#include <mpg123.h>
+
 #include "mpg123xx/format.hpp"
 
 #include "utils.hpp"
@@ -55,6 +57,30 @@ namespace mpg123 {
         }
 
     } // namespace
+
+
+    std::span<const long>
+    supported_rates()
+        noexcept
+    {
+        const long* list = nullptr;
+        std::size_t number = 0;
+        mpg123_rates(&list, &number);
+        return {list, number};
+    }
+
+
+    std::span<const int>
+    supported_encodings()
+        noexcept
+    {
+        const int* list = nullptr;
+        std::size_t number = 0;
+        mpg123_encodings(&list, &number);
+        return {list, number};
+    }
+
+
     std::string
     to_string(const format& fmt)
     {
@@ -73,4 +99,30 @@ namespace mpg123 {
         return out << to_string(fmt);
     }
 
+
+    std::string
+    to_string(const conversion& conv)
+    {
+        std::ostringstream out;
+        out << "{ input: " << std::to_string(conv.input_rate) << " Hz "
+            << channels_to_string(conv.input_channels) << " ; "
+            << "output: " << to_string(conv.output);
+        if (conv.resampling)
+            out << " ; resampling";
+        if (conv.remixing)
+            out << " ; remixing";
+        if (conv.converting)
+            out << " ; converting";
+        out << " }";
+        return out.str();
+    }
+
+
+    std::ostream&
+    operator <<(std::ostream& out,
+                const conversion& conv)
+    {
+        return out << to_string(conv);
+    }
+
 } // namespace mpg123
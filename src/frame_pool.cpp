@@ -0,0 +1,352 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "mpg123xx/frame_pool.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+using std::expected;
+using std::unexpected;
+
+
+namespace mpg123 {
+
+    namespace detail {
+
+        // The header sits at the start of the block, the samples follow it.
+        struct frame_block {
+
+            static constexpr std::size_t alignment = 64;
+
+            std::atomic<unsigned> refs{0};
+            frame_pool* pool;
+            frame_block* next_free = nullptr;
+            frame_block* next_all = nullptr;
+            std::intmax_t num = 0;
+            std::size_t used = 0;
+
+
+            explicit
+            frame_block(frame_pool* pool)
+                noexcept :
+                pool{pool}
+            {}
+
+
+            static constexpr
+            std::size_t
+            header_size()
+                noexcept
+            {
+                return (sizeof(frame_block) + alignment - 1) / alignment * alignment;
+            }
+
+
+            std::byte*
+            data()
+                noexcept
+            {
+                return reinterpret_cast<std::byte*>(this) + header_size();
+            }
+
+        };
+
+    } // namespace detail
+
+
+    using detail::frame_block;
+
+
+    frame_buffer::frame_buffer(frame_block* block)
+        noexcept :
+        block{block}
+    {
+        if (block)
+            block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    frame_buffer::frame_buffer(const frame_buffer& other)
+        noexcept :
+        frame_buffer{other.block}
+    {}
+
+
+    frame_buffer::frame_buffer(frame_buffer&& other)
+        noexcept :
+        block{std::exchange(other.block, nullptr)}
+    {}
+
+
+    frame_buffer::~frame_buffer()
+        noexcept
+    {
+        reset();
+    }
+
+
+    frame_buffer&
+    frame_buffer::operator =(const frame_buffer& other)
+        noexcept
+    {
+        if (this != &other) {
+            if (other.block)
+                other.block->refs.fetch_add(1, std::memory_order_relaxed);
+            reset();
+            block = other.block;
+        }
+        return *this;
+    }
+
+
+    frame_buffer&
+    frame_buffer::operator =(frame_buffer&& other)
+        noexcept
+    {
+        if (this != &other) {
+            reset();
+            block = std::exchange(other.block, nullptr);
+        }
+        return *this;
+    }
+
+
+    void
+    frame_buffer::reset()
+        noexcept
+    {
+        if (!block)
+            return;
+        if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            block->pool->release(block);
+        block = nullptr;
+    }
+
+
+    frame_buffer::operator bool()
+        const noexcept
+    {
+        return block;
+    }
+
+
+    std::intmax_t
+    frame_buffer::num()
+        const noexcept
+    {
+        assert(block);
+        return block->num;
+    }
+
+
+    std::span<const std::byte>
+    frame_buffer::samples()
+        const noexcept
+    {
+        if (!block)
+            return {};
+        return { block->data(), block->used };
+    }
+
+
+    std::span<std::byte>
+    frame_buffer::mutable_samples()
+        noexcept
+    {
+        if (!block)
+            return {};
+        return { block->data(), block->used };
+    }
+
+
+    bool
+    frame_buffer::unique()
+        const noexcept
+    {
+        return block && block->refs.load(std::memory_order_acquire) == 1;
+    }
+
+
+    frame_pool::frame_pool(std::size_t block_size,
+                           std::size_t initial_blocks) :
+        size{block_size}
+    {
+        reserve(initial_blocks);
+    }
+
+
+    frame_pool::~frame_pool()
+        noexcept
+    {
+        assert(num_free == num_blocks && "frame_buffer outlived its frame_pool");
+        while (all_blocks) {
+            frame_block* b = std::exchange(all_blocks, all_blocks->next_all);
+            b->~frame_block();
+            ::operator delete(b, std::align_val_t{frame_block::alignment});
+        }
+    }
+
+
+    std::size_t
+    frame_pool::block_size()
+        const noexcept
+    {
+        return size;
+    }
+
+
+    std::size_t
+    frame_pool::capacity()
+        const noexcept
+    {
+        std::lock_guard guard{mutex};
+        return num_blocks;
+    }
+
+
+    std::size_t
+    frame_pool::available()
+        const noexcept
+    {
+        std::lock_guard guard{mutex};
+        return num_free;
+    }
+
+
+    void
+    frame_pool::reserve(std::size_t blocks)
+    {
+        std::lock_guard guard{mutex};
+        while (num_blocks < blocks) {
+            void* mem = ::operator new(frame_block::header_size() + size,
+                                       std::align_val_t{frame_block::alignment});
+            auto b = new (mem) frame_block{this};
+            b->next_all = std::exchange(all_blocks, b);
+            b->next_free = std::exchange(free_list, b);
+            ++num_blocks;
+            ++num_free;
+        }
+    }
+
+
+    frame_block*
+    frame_pool::acquire()
+    {
+        {
+            std::lock_guard guard{mutex};
+            if (free_list) {
+                --num_free;
+                return std::exchange(free_list, free_list->next_free);
+            }
+        }
+        // Allocate outside the lock, so other threads can keep releasing.
+        void* mem = ::operator new(frame_block::header_size() + size,
+                                   std::align_val_t{frame_block::alignment});
+        auto b = new (mem) frame_block{this};
+        std::lock_guard guard{mutex};
+        b->next_all = std::exchange(all_blocks, b);
+        ++num_blocks;
+        return b;
+    }
+
+
+    void
+    frame_pool::release(frame_block* block)
+        noexcept
+    {
+        std::lock_guard guard{mutex};
+        block->next_free = std::exchange(free_list, block);
+        ++num_free;
+    }
+
+
+    frame_buffer
+    frame_pool::copy(const frame& f)
+    {
+        if (f.samples.size() > size)
+            throw std::length_error{"frame doesn't fit in the pool's blocks"};
+        frame_block* b = acquire();
+        b->num = f.num;
+        b->used = f.samples.size();
+        std::ranges::copy(f.samples, b->data());
+        return frame_buffer{b};
+    }
+
+
+    frame_buffer
+    frame_pool::decode(handle& h)
+    {
+        auto result = try_decode(h);
+        if (!result)
+            throw result.error();
+        return std::move(*result);
+    }
+
+
+    expected<frame_buffer, error>
+    frame_pool::try_decode(handle& h)
+        noexcept
+    {
+        auto f = h.try_decode_frame();
+        if (!f)
+            return unexpected{f.error()};
+        if (f->samples.size() > size)
+            return unexpected{error{MPG123_NO_SPACE}};
+        try {
+            return copy(*f);
+        }
+        catch (std::bad_alloc&) {
+            return unexpected{error{MPG123_OUT_OF_MEM}};
+        }
+    }
+
+
+    frame_buffer
+    frame_pool::decode_direct(handle& h)
+    {
+        auto result = try_decode_direct(h);
+        if (!result)
+            throw result.error();
+        return std::move(*result);
+    }
+
+
+    expected<frame_buffer, error>
+    frame_pool::try_decode_direct(handle& h)
+        noexcept
+    {
+        if (size < h.outblock())
+            return unexpected{error{MPG123_NO_SPACE}};
+        frame_block* b = nullptr;
+        try {
+            b = acquire();
+        }
+        catch (std::bad_alloc&) {
+            return unexpected{error{MPG123_OUT_OF_MEM}};
+        }
+        // Hold the block right away, so it goes back to the pool on errors.
+        frame_buffer result{b};
+        if (auto r = h.try_replace_buffer({b->data(), size}); !r)
+            return unexpected{r.error()};
+        auto f = h.try_decode_frame();
+        if (!f)
+            return unexpected{f.error()};
+        assert(f->samples.empty() || f->samples.data() == b->data());
+        b->num = f->num;
+        b->used = f->samples.size();
+        return result;
+    }
+
+} // namespace mpg123
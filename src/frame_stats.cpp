@@ -0,0 +1,99 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "mpg123xx/frame_stats.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        unsigned
+        samples_per_frame(const mpg123_frameinfo2& info)
+            noexcept
+        {
+            switch (info.layer) {
+                case 1:
+                    return 384;
+                case 2:
+                    return 1152;
+                default:
+                    return info.version == MPG123_1_0 ? 1152 : 576;
+            }
+        }
+
+    } // namespace
+
+
+    frame_stats
+    scan_frames(handle& h)
+    {
+        frame_stats st;
+        // Where the next frame should start, if there's nothing between them.
+        std::intmax_t expected = -1;
+        for (;;) {
+            auto next = h.try_framebyframe_next();
+            if (!next) {
+                // Running out of input in feed mode is not a failure.
+                if (next.error().code != MPG123_DONE && next.error().code != MPG123_NEED_MORE)
+                    st.failure = next.error();
+                break;
+            }
+            auto info = h.try_get_info();
+            if (!info) {
+                st.failure = info.error();
+                break;
+            }
+
+            const std::intmax_t offset = h.framepos();
+            if (!st.frames) {
+                st.first_offset = offset;
+                st.declared_vbr = info->vbr;
+            } else {
+                if (*next)
+                    ++st.format_changes;
+                if (offset > expected) {
+                    ++st.resyncs;
+                    st.skipped_bytes += offset - expected;
+                }
+            }
+            expected = offset + info->framesize;
+            st.end_offset = expected;
+
+            ++st.frames;
+            st.bytes += info->framesize;
+            if (info->rate > 0)
+                st.duration += double(samples_per_frame(*info)) / info->rate;
+            ++st.bitrates[info->bitrate];
+            ++st.rates[info->rate];
+            if (unsigned(info->version) < st.versions.size())
+                ++st.versions[info->version];
+            if (unsigned(info->layer) < st.layers.size())
+                ++st.layers[info->layer];
+            if (unsigned(info->mode) < st.modes.size())
+                ++st.modes[info->mode];
+            if (info->flags & MPG123_CRC)
+                ++st.crc_frames;
+        }
+        return st;
+    }
+
+
+    frame_stats
+    scan_frames(const path& filename)
+    {
+        handle h;
+        // Nothing is sought, so skip the index; resyncs are counted, not printed.
+        h.set_seek_policy(seek_policy::fixed(0));
+        h.add_flags(MPG123_QUIET);
+        h.open(filename);
+        return scan_frames(h);
+    }
+
+} // namespace mpg123
@@ -5,7 +5,14 @@
  * SPDX-License-Identifier: LGPL-3.0-or-later
  */
 
+#include <algorithm>
 #include <cassert>
+#include <new>
+#include <utility>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include "mpg123xx/handle.hpp"
 
@@ -16,6 +23,35 @@ using std::unexpected;
 
 namespace mpg123 {
 
+    namespace {
+
+        // Heap memory taken by a new handle, with no index, feed pool or output
+        // buffer yet.
+        std::size_t
+        fresh_handle_bytes()
+            noexcept
+        {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+            static const std::size_t result = []() -> std::size_t
+            {
+                // Note: allocations from other threads meanwhile skew this.
+                const auto before = ::mallinfo2().uordblks;
+                mpg123_handle* h = mpg123_new(nullptr, nullptr);
+                if (!h)
+                    return 0;
+                mpg123_param(h, MPG123_INDEX_SIZE, 0, 0.0);
+                const auto after = ::mallinfo2().uordblks;
+                mpg123_delete(h);
+                return after > before ? after - before : 0;
+            }();
+            return result;
+#else
+            return 0;
+#endif
+        }
+
+    } // namespace
+
 
     handle::handle(const char* decoder)
     {
@@ -29,6 +65,14 @@ namespace mpg123 {
     }
 
 
+    handle::handle(const memory_profile& profile,
+                   const char* decoder)
+    {
+        create(decoder);
+        set_memory_profile(profile);
+    }
+
+
     handle
     handle::from_file(const path& filename)
     {
@@ -49,6 +93,19 @@ namespace mpg123 {
     }
 
 
+    handle
+    handle::from_file(const path& filename,
+                      const seek_policy& policy)
+    {
+        handle h;
+        h.set_seek_policy(policy);
+        h.open(filename);
+        if (policy.prescan)
+            h.scan();
+        return h;
+    }
+
+
     handle::~handle()
         noexcept
     {
@@ -140,52 +197,40 @@ namespace mpg123 {
     }
 
 
-    format
-    handle::get_format()
+    void
+    handle::set_down_sample(int factor)
     {
-        auto result = try_get_format();
+        auto result = try_set_down_sample(factor);
         if (!result)
             throw result.error();
-        return *result;
     }
 
 
-    std::expected<format, error>
-    handle::try_get_format()
+    expected<void, error>
+    handle::try_set_down_sample(int factor)
         noexcept
     {
-        long rate = 0;
-        int channels = 0;
-        int encoding = 0;
-        int e = mpg123_getformat(raw, &rate, &channels, &encoding);
+        int e = mpg123_param(raw, MPG123_DOWN_SAMPLE, factor, 0.0);
         if (e != MPG123_OK)
             return unexpected{error{this}};
-        return format{
-            .rate = rate,
-            .channels = static_cast<unsigned>(channels),
-            .encoding = static_cast<unsigned>(encoding)
-        };
+        return {};
     }
 
 
     void
-    handle::set_format(long rate,
-                       unsigned channels,
-                       unsigned encoding)
+    handle::set_force_rate(long rate)
     {
-        auto result = try_set_format(rate, channels, encoding);
+        auto result = try_set_force_rate(rate);
         if (!result)
             throw result.error();
     }
 
 
     expected<void, error>
-    handle::try_set_format(long rate,
-                           unsigned channels,
-                           unsigned encoding)
+    handle::try_set_force_rate(long rate)
         noexcept
     {
-        int e = mpg123_format(raw, rate, channels, encoding);
+        int e = mpg123_param(raw, MPG123_FORCE_RATE, rate, 0.0);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return {};
@@ -193,39 +238,112 @@ namespace mpg123 {
 
 
     void
-    handle::open_feed()
+    handle::set_memory_profile(const memory_profile& profile)
     {
-        auto result = try_open_feed();
+        auto result = try_set_memory_profile(profile);
         if (!result)
             throw result.error();
     }
 
 
     expected<void, error>
-    handle::try_open_feed()
+    handle::try_set_memory_profile(const memory_profile& profile)
         noexcept
     {
-        int e = mpg123_open_feed(raw);
+        const std::pair<mpg123_parms, long> params[] = {
+            { MPG123_INDEX_SIZE, profile.index_size },
+            { MPG123_FEEDPOOL,   profile.feed_pool },
+            { MPG123_FEEDBUFFER, profile.feed_buffer },
+        };
+        for (auto [key, value] : params) {
+            int e = mpg123_param(raw, key, value, 0.0);
+            if (e != MPG123_OK)
+                return unexpected{error{this}};
+        }
+        auto toggle = [this](unsigned flag, bool enable)
+        {
+            if (enable)
+                add_flags(flag);
+            else
+                remove_flags(flag);
+        };
+        toggle(MPG123_SKIP_ID3V2, profile.skip_id3v2);
+        toggle(MPG123_IGNORE_INFOFRAME, profile.ignore_infoframe);
+        toggle(MPG123_PICTURE, profile.pictures);
+        return {};
+    }
+
+
+    std::size_t
+    handle::resident_bytes()
+        noexcept
+    {
+        std::size_t result = fresh_handle_bytes();
+
+        long index_size = 0;
+        mpg123_getparam(raw, MPG123_INDEX_SIZE, &index_size, nullptr);
+        if (index_size > 0)
+            result += index_size * sizeof(off_t);
+        else if (index_size < 0)
+            if (auto index = try_get_seek_index())
+                result += index->memory();
+
+        long pool = 0;
+        long block = 0;
+        mpg123_getparam(raw, MPG123_FEEDPOOL, &pool, nullptr);
+        mpg123_getparam(raw, MPG123_FEEDBUFFER, &block, nullptr);
+        result += pool * block;
+        // Only valid in feed mode.
+        if (auto fill = try_get_state(MPG123_BUFFERFILL))
+            result += *fill;
+
+        result += outblock();
+        return result;
+    }
+
+
+    void
+    handle::set_seek_policy(const seek_policy& policy)
+    {
+        auto result = try_set_seek_policy(policy);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_set_seek_policy(const seek_policy& policy)
+        noexcept
+    {
+        int e = mpg123_param(raw, MPG123_INDEX_SIZE, policy.index_size, 0.0);
         if (e != MPG123_OK)
             return unexpected{error{this}};
+        if (policy.fuzzy)
+            add_flags(MPG123_FUZZY);
+        else
+            remove_flags(MPG123_FUZZY);
+        if (policy.seekbuffer)
+            add_flags(MPG123_SEEKBUFFER);
+        else
+            remove_flags(MPG123_SEEKBUFFER);
         return {};
     }
 
 
     void
-    handle::open(const path& filename)
+    handle::set_volume(double vol)
     {
-        auto result = try_open(filename);
+        auto result = try_set_volume(vol);
         if (!result)
             throw result.error();
     }
 
 
     expected<void, error>
-    handle::try_open(const path& filename)
+    handle::try_set_volume(double vol)
         noexcept
     {
-        int e = mpg123_open(raw, filename.c_str());
+        int e = mpg123_volume(raw, vol);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return {};
@@ -233,23 +351,19 @@ namespace mpg123 {
 
 
     void
-    handle::open(const path& filename,
-                 mpg123_channelcount channels,
-                 mpg123_enc_enum encoding)
+    handle::change_volume(double delta)
     {
-        auto result = try_open(filename, channels, encoding);
+        auto result = try_change_volume(delta);
         if (!result)
             throw result.error();
     }
 
 
-    std::expected<void, error>
-    handle::try_open(const path& filename,
-                     mpg123_channelcount channels,
-                     mpg123_enc_enum encoding)
+    expected<void, error>
+    handle::try_change_volume(double delta)
         noexcept
     {
-        int e = mpg123_open_fixed(raw, filename.c_str(), channels, encoding);
+        int e = mpg123_volume_change(raw, delta);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return {};
@@ -257,133 +371,1026 @@ namespace mpg123 {
 
 
     void
-    handle::close()
+    handle::change_volume_db(double db)
     {
-        auto result = try_close();
+        auto result = try_change_volume_db(db);
         if (!result)
             throw result.error();
     }
 
 
     expected<void, error>
-    handle::try_close()
+    handle::try_change_volume_db(double db)
         noexcept
     {
-        int e = mpg123_close(raw);
+        int e = mpg123_volume_change_db(raw, db);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return {};
     }
 
 
-    std::size_t
-    handle::read(void* buf,
-                 std::size_t size)
+    volume
+    handle::get_volume()
     {
-        auto result = try_read(buf, size);
+        auto result = try_get_volume();
         if (!result)
             throw result.error();
         return *result;
     }
 
 
-    std::expected<std::size_t, error>
-    handle::try_read(void* buf,
-                     std::size_t size)
+    expected<volume, error>
+    handle::try_get_volume()
         noexcept
     {
-        std::size_t result = 0;
-        int e = mpg123_read(raw, buf, size, &result);
+        volume result{};
+        int e = mpg123_getvolume(raw, &result.base, &result.really, &result.rva_db);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return result;
     }
 
 
-    frame
-    handle::decode_frame()
+    void
+    handle::set_rva(mpg123_param_rva mode)
+        noexcept
     {
-        auto result = try_decode_frame();
+        int e = mpg123_param(raw, MPG123_RVA, mode, 0.0);
+        assert(e == MPG123_OK);
+    }
+
+
+    mpg123_param_rva
+    handle::get_rva()
+        const noexcept
+    {
+        long lval = 0;
+        int e = mpg123_getparam(raw, MPG123_RVA, &lval, nullptr);
+        assert(e == MPG123_OK);
+        return static_cast<mpg123_param_rva>(lval);
+    }
+
+
+    void
+    handle::set_eq(mpg123_channels channel,
+                   int band,
+                   double value)
+    {
+        auto result = try_set_eq(channel, band, value);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_set_eq(mpg123_channels channel,
+                       int band,
+                       double value)
+        noexcept
+    {
+        int e = mpg123_eq(raw, channel, band, value);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    double
+    handle::get_eq(mpg123_channels channel,
+                   int band)
+        noexcept
+    {
+        return mpg123_geteq(raw, channel, band);
+    }
+
+
+    void
+    handle::set_equalizer(const equalizer& eq)
+    {
+        auto result = try_set_equalizer(eq);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_set_equalizer(const equalizer& eq)
+        noexcept
+    {
+        auto apply = [this](const equalizer& curve) -> expected<void, error>
+        {
+            for (int band = 0; band < eq_bands; ++band) {
+                if (curve.left[band] == curve.right[band]) {
+                    if (auto r = try_set_eq(MPG123_LR, band, curve.left[band]); !r)
+                        return r;
+                } else {
+                    if (auto r = try_set_eq(MPG123_LEFT, band, curve.left[band]); !r)
+                        return r;
+                    if (auto r = try_set_eq(MPG123_RIGHT, band, curve.right[band]); !r)
+                        return r;
+                }
+            }
+            return {};
+        };
+
+        // Note: nothing is decoded between these calls, so the next frame sees
+        // either the whole new curve or, on failure, the old one restored.
+        const equalizer old = get_equalizer();
+        auto result = apply(eq);
+        if (!result)
+            apply(old);
+        return result;
+    }
+
+
+    equalizer
+    handle::get_equalizer()
+        noexcept
+    {
+        equalizer result;
+        for (int band = 0; band < eq_bands; ++band) {
+            result.left[band] = get_eq(MPG123_LEFT, band);
+            result.right[band] = get_eq(MPG123_RIGHT, band);
+        }
+        return result;
+    }
+
+
+    void
+    handle::reset_eq()
+    {
+        auto result = try_reset_eq();
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_reset_eq()
+        noexcept
+    {
+        int e = mpg123_reset_eq(raw);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    format
+    handle::get_format()
+    {
+        auto result = try_get_format();
         if (!result)
             throw result.error();
         return *result;
     }
 
 
-    std::expected<frame, error>
-    handle::try_decode_frame()
+    std::expected<format, error>
+    handle::try_get_format()
         noexcept
     {
-        off_t num = 0;
-        std::byte* data = nullptr;
-        std::size_t size = 0;
-        int e = mpg123_decode_frame(raw,
-                                    &num,
-                                    reinterpret_cast<unsigned char**>(&data),
-                                    &size);
+        long rate = 0;
+        int channels = 0;
+        int encoding = 0;
+        int e = mpg123_getformat(raw, &rate, &channels, &encoding);
         if (e != MPG123_OK)
             return unexpected{error{this}};
-        return frame{
-            .num = num,
-            .samples = std::span<const std::byte>(data, size)
+        return format{
+            .rate = rate,
+            .channels = static_cast<unsigned>(channels),
+            .encoding = static_cast<unsigned>(encoding)
         };
     }
 
 
     void
-    handle::feed(const void* buf,
-                 std::size_t size)
+    handle::set_format(long rate,
+                       unsigned channels,
+                       unsigned encoding)
     {
-        auto result = try_feed(buf, size);
+        auto result = try_set_format(rate, channels, encoding);
         if (!result)
             throw result.error();
     }
 
 
     expected<void, error>
-    handle::try_feed(const void* buf,
-                     std::size_t size)
+    handle::try_set_format(long rate,
+                           unsigned channels,
+                           unsigned encoding)
         noexcept
     {
-        int e = mpg123_feed(raw,
-                            static_cast<const unsigned char*>(buf),
-                            size);
+        int e = mpg123_format(raw, rate, channels, encoding);
         if (e != MPG123_OK)
             return unexpected{error{this}};
         return {};
     }
 
 
-    unsigned
-    handle::meta_check()
+    void
+    handle::format_none()
+    {
+        auto result = try_format_none();
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_format_none()
         noexcept
     {
-        return mpg123_meta_check(raw);
+        int e = mpg123_format_none(raw);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
     }
 
 
-    id3
-    handle::get_id3()
+    void
+    handle::format_all()
     {
-        auto result = try_get_id3();
+        auto result = try_format_all();
         if (!result)
             throw result.error();
-        return std::move(*result);
     }
 
 
-    expected<id3, error>
-    handle::try_get_id3()
+    expected<void, error>
+    handle::try_format_all()
         noexcept
     {
-        mpg123_id3v1* v1 = nullptr;
-        mpg123_id3v2* v2 = nullptr;
-        int e = mpg123_id3(raw, &v1, &v2);
-        if  (e != MPG123_OK)
+        int e = mpg123_format_all(raw);
+        if (e != MPG123_OK)
             return unexpected{error{this}};
-        id3 result{ v1, v2 };
-        mpg123_meta_free(raw);
-        return result;
+        return {};
+    }
+
+
+    unsigned
+    handle::format_support(long rate,
+                           unsigned encoding)
+        noexcept
+    {
+        int result = mpg123_format_support(raw, rate, encoding);
+        return result > 0 ? result : 0;
+    }
+
+
+    unsigned
+    handle::negotiate_format(std::span<const unsigned> encodings,
+                             unsigned channels,
+                             long rate)
+    {
+        auto result = try_negotiate_format(encodings, channels, rate);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<unsigned, error>
+    handle::try_negotiate_format(std::span<const unsigned> encodings,
+                                 unsigned channels,
+                                 long rate)
+        noexcept
+    {
+        if (!channels || channels & ~unsigned(MPG123_MONO | MPG123_STEREO))
+            return unexpected{error{MPG123_BAD_CHANNEL}};
+        const auto rates = supported_rates();
+        if (rate && std::ranges::find(rates, rate) == rates.end())
+            return unexpected{error{MPG123_BAD_RATE}};
+
+        // Check against what the build supports, without touching the format
+        // table, so it's left as it was if nothing fits.
+        const auto built = supported_encodings();
+        auto usable = [built](unsigned enc) -> bool
+        {
+            return std::ranges::find(built, int(enc)) != built.end();
+        };
+
+        unsigned chosen = 0;
+        for (unsigned enc : encodings)
+            if (is_native_encoding(enc) && usable(enc)) {
+                chosen = enc;
+                break;
+            }
+        if (!chosen)
+            for (unsigned enc : encodings)
+                if (usable(enc)) {
+                    chosen = enc;
+                    break;
+                }
+        if (!chosen)
+            return unexpected{error{MPG123_BAD_OUTFORMAT}};
+
+        if (auto r = try_format_none(); !r)
+            return unexpected{r.error()};
+        if (rate) {
+            if (auto r = try_set_format(rate, channels, chosen); !r)
+                return unexpected{r.error()};
+        } else {
+            bool any = false;
+            for (long r : rates)
+                any |= mpg123_format(raw, r, channels, chosen) == MPG123_OK;
+            if (!any)
+                return unexpected{error{MPG123_BAD_OUTFORMAT}};
+        }
+        return chosen;
+    }
+
+
+    void
+    handle::force_format(const format& fmt)
+    {
+        auto result = try_force_format(fmt);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_force_format(const format& fmt)
+        noexcept
+    {
+        if (fmt.channels != MPG123_MONO && fmt.channels != MPG123_STEREO)
+            return unexpected{error{MPG123_BAD_CHANNEL}};
+        if (fmt.rate <= 0)
+            return unexpected{error{MPG123_BAD_RATE}};
+        const auto built = supported_encodings();
+        if (std::ranges::find(built, int(fmt.encoding)) == built.end())
+            return unexpected{error{MPG123_BAD_OUTFORMAT}};
+
+        const unsigned old_flags = get_flags();
+        long old_rate = 0;
+        mpg123_getparam(raw, MPG123_FORCE_RATE, &old_rate, nullptr);
+        auto restore = [&, this]
+        {
+            mpg123_param(raw, MPG123_FORCE_RATE, old_rate, 0.0);
+            set_flags(old_flags);
+        };
+
+        // The forced rate goes first: libmpg123 only accepts a non-standard rate
+        // in the format table once it's the forced one.
+        if (auto r = try_set_force_rate(fmt.rate); !r)
+            return unexpected{r.error()};
+        remove_flags(MPG123_FORCE_MONO | MPG123_FORCE_STEREO);
+        add_flags(fmt.channels == MPG123_MONO ? MPG123_MONO_MIX : MPG123_FORCE_STEREO);
+        auto r = try_format_none();
+        if (r)
+            r = try_set_format(fmt.rate, fmt.channels, fmt.encoding);
+        if (!r)
+            restore();
+        return r;
+    }
+
+
+    conversion
+    handle::get_conversion()
+    {
+        auto result = try_get_conversion();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<conversion, error>
+    handle::try_get_conversion()
+        noexcept
+    {
+        // Note: get the format first, it makes libmpg123 parse the first frame.
+        auto fmt = try_get_format();
+        if (!fmt)
+            return unexpected{fmt.error()};
+        auto info = try_get_info();
+        if (!info)
+            return unexpected{info.error()};
+        unsigned input_channels = info->mode == MPG123_M_MONO ? 1 : 2;
+        return conversion{
+            .input_rate = info->rate,
+            .input_channels = input_channels,
+            .output = *fmt,
+            .resampling = fmt->rate != info->rate,
+            .remixing = fmt->channels != input_channels,
+            .converting = !is_native_encoding(fmt->encoding)
+        };
+    }
+
+
+    mpg123_frameinfo2
+    handle::get_info()
+    {
+        auto result = try_get_info();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<mpg123_frameinfo2, error>
+    handle::try_get_info()
+        noexcept
+    {
+        mpg123_frameinfo2 info{};
+        int e = mpg123_info2(raw, &info);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return info;
+    }
+
+
+    void
+    handle::open_feed()
+    {
+        auto result = try_open_feed();
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_open_feed()
+        noexcept
+    {
+        new_format_pending = false;
+        int e = mpg123_open_feed(raw);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    void
+    handle::open(const path& filename)
+    {
+        auto result = try_open(filename);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_open(const path& filename)
+        noexcept
+    {
+        new_format_pending = false;
+        int e = mpg123_open(raw, filename.c_str());
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    void
+    handle::open(const path& filename,
+                 mpg123_channelcount channels,
+                 mpg123_enc_enum encoding)
+    {
+        auto result = try_open(filename, channels, encoding);
+        if (!result)
+            throw result.error();
+    }
+
+
+    std::expected<void, error>
+    handle::try_open(const path& filename,
+                     mpg123_channelcount channels,
+                     mpg123_enc_enum encoding)
+        noexcept
+    {
+        new_format_pending = false;
+        int e = mpg123_open_fixed(raw, filename.c_str(), channels, encoding);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    void
+    handle::close()
+    {
+        auto result = try_close();
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_close()
+        noexcept
+    {
+        new_format_pending = false;
+        int e = mpg123_close(raw);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    std::size_t
+    handle::read(void* buf,
+                 std::size_t size)
+    {
+        auto result = try_read(buf, size);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    std::expected<std::size_t, error>
+    handle::try_read(void* buf,
+                     std::size_t size)
+        noexcept
+    {
+        if (std::exchange(new_format_pending, false))
+            return unexpected{error{MPG123_NEW_FORMAT}};
+        std::size_t result = 0;
+        int e = mpg123_read(raw, buf, size, &result);
+        // Return the partial data first. DONE and NEED_MORE are reported again by
+        // the next mpg123_read(), but NEW_FORMAT is not, so remember it.
+        if (result) {
+            if (e == MPG123_NEW_FORMAT) {
+                new_format_pending = true;
+                return result;
+            }
+            if (e == MPG123_DONE || e == MPG123_NEED_MORE)
+                return result;
+        }
+        if (e == MPG123_ERR)
+            return unexpected{error{this}};
+        if (e != MPG123_OK)
+            return unexpected{error{e}};
+        return result;
+    }
+
+
+    frame
+    handle::decode_frame()
+    {
+        auto result = try_decode_frame();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    std::expected<frame, error>
+    handle::try_decode_frame()
+        noexcept
+    {
+        off_t num = 0;
+        std::byte* data = nullptr;
+        std::size_t size = 0;
+        int e = mpg123_decode_frame(raw,
+                                    &num,
+                                    reinterpret_cast<unsigned char**>(&data),
+                                    &size);
+        if (e == MPG123_ERR)
+            return unexpected{error{this}};
+        if (e != MPG123_OK)
+            return unexpected{error{e}};
+        return frame{
+            .num = num,
+            .samples = std::span<const std::byte>(data, size)
+        };
+    }
+
+
+    bool
+    handle::framebyframe_next()
+    {
+        auto result = try_framebyframe_next();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<bool, error>
+    handle::try_framebyframe_next()
+        noexcept
+    {
+        int e = mpg123_framebyframe_next(raw);
+        if (e == MPG123_NEW_FORMAT)
+            return true;
+        if (e == MPG123_ERR)
+            return unexpected{error{this}};
+        if (e != MPG123_OK)
+            return unexpected{error{e}};
+        return false;
+    }
+
+
+    frame
+    handle::framebyframe_decode()
+    {
+        auto result = try_framebyframe_decode();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<frame, error>
+    handle::try_framebyframe_decode()
+        noexcept
+    {
+        off_t num = 0;
+        std::byte* data = nullptr;
+        std::size_t size = 0;
+        int e = mpg123_framebyframe_decode(raw,
+                                           &num,
+                                           reinterpret_cast<unsigned char**>(&data),
+                                           &size);
+        if (e == MPG123_ERR)
+            return unexpected{error{this}};
+        if (e != MPG123_OK)
+            return unexpected{error{e}};
+        return frame{
+            .num = num,
+            .samples = std::span<const std::byte>(data, size)
+        };
+    }
+
+
+    raw_frame
+    handle::get_frame_data()
+    {
+        auto result = try_get_frame_data();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<raw_frame, error>
+    handle::try_get_frame_data()
+        noexcept
+    {
+        unsigned long header = 0;
+        std::byte* body = nullptr;
+        std::size_t size = 0;
+        int e = mpg123_framedata(raw,
+                                 &header,
+                                 reinterpret_cast<unsigned char**>(&body),
+                                 &size);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return raw_frame{
+            .header = static_cast<std::uint32_t>(header),
+            .body = std::span<const std::byte>(body, size),
+            .offset = mpg123_framepos(raw)
+        };
+    }
+
+
+    void
+    handle::replace_buffer(std::span<std::byte> buf)
+    {
+        auto result = try_replace_buffer(buf);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_replace_buffer(std::span<std::byte> buf)
+        noexcept
+    {
+        int e = mpg123_replace_buffer(raw,
+                                      reinterpret_cast<unsigned char*>(buf.data()),
+                                      buf.size());
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    std::size_t
+    handle::outblock()
+        noexcept
+    {
+        return mpg123_outblock(raw);
+    }
+
+
+    double
+    handle::tpf()
+        noexcept
+    {
+        return mpg123_tpf(raw);
+    }
+
+
+    std::intmax_t
+    handle::framepos()
+        noexcept
+    {
+        return mpg123_framepos(raw);
+    }
+
+
+    void
+    handle::feed(const void* buf,
+                 std::size_t size)
+    {
+        auto result = try_feed(buf, size);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_feed(const void* buf,
+                     std::size_t size)
+        noexcept
+    {
+        int e = mpg123_feed(raw,
+                            static_cast<const unsigned char*>(buf),
+                            size);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    void
+    handle::feed(std::span<const std::span<const std::byte>> fragments)
+    {
+        auto result = try_feed(fragments);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_feed(std::span<const std::span<const std::byte>> fragments)
+        noexcept
+    {
+        for (auto frag : fragments) {
+            if (frag.empty())
+                continue;
+            int e = mpg123_feed(raw,
+                                reinterpret_cast<const unsigned char*>(frag.data()),
+                                frag.size());
+            if (e != MPG123_OK)
+                return unexpected{error{this}};
+        }
+        return {};
+    }
+
+
+    std::intmax_t
+    handle::seek(std::intmax_t sample,
+                 int whence)
+    {
+        auto result = try_seek(sample, whence);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<std::intmax_t, error>
+    handle::try_seek(std::intmax_t sample,
+                     int whence)
+        noexcept
+    {
+        // Note: a pending NEW_FORMAT is kept; libmpg123 already switched to that
+        // format and won't report it again after the seek.
+        off_t result = mpg123_seek(raw, sample, whence);
+        if (result < 0)
+            return unexpected{error{this}};
+        return result;
+    }
+
+
+    std::intmax_t
+    handle::seek_frame(std::intmax_t frame,
+                       int whence)
+    {
+        auto result = try_seek_frame(frame, whence);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<std::intmax_t, error>
+    handle::try_seek_frame(std::intmax_t frame,
+                           int whence)
+        noexcept
+    {
+        off_t result = mpg123_seek_frame(raw, frame, whence);
+        if (result < 0)
+            return unexpected{error{this}};
+        return result;
+    }
+
+
+    std::intmax_t
+    handle::tell()
+        noexcept
+    {
+        return mpg123_tell(raw);
+    }
+
+
+    std::intmax_t
+    handle::tellframe()
+        noexcept
+    {
+        return mpg123_tellframe(raw);
+    }
+
+
+    void
+    handle::scan()
+    {
+        auto result = try_scan();
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_scan()
+        noexcept
+    {
+        int e = mpg123_scan(raw);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    seek_index
+    handle::get_seek_index()
+    {
+        auto result = try_get_seek_index();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<seek_index, error>
+    handle::try_get_seek_index()
+        noexcept
+    {
+        off_t* offsets = nullptr;
+        off_t step = 0;
+        std::size_t fill = 0;
+        int e = mpg123_index(raw, &offsets, &step, &fill);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return seek_index{
+            .offsets = std::span<const off_t>(offsets, fill),
+            .step = step
+        };
+    }
+
+
+    void
+    handle::set_seek_index(const seek_index& index)
+    {
+        auto result = try_set_seek_index(index);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    handle::try_set_seek_index(const seek_index& index)
+        noexcept
+    {
+        // Note: libmpg123 copies the entries, it doesn't write to them.
+        int e = mpg123_set_index(raw,
+                                 const_cast<off_t*>(index.offsets.data()),
+                                 index.step,
+                                 index.offsets.size());
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return {};
+    }
+
+
+    std::intmax_t
+    handle::length()
+    {
+        auto result = try_length();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<std::intmax_t, error>
+    handle::try_length()
+        noexcept
+    {
+        off_t result = mpg123_length(raw);
+        if (result < 0)
+            return unexpected{error{this}};
+        return result;
+    }
+
+
+    long
+    handle::get_state(mpg123_state key)
+    {
+        auto result = try_get_state(key);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<long, error>
+    handle::try_get_state(mpg123_state key)
+        noexcept
+    {
+        long result = 0;
+        int e = mpg123_getstate(raw, key, &result, nullptr);
+        if (e != MPG123_OK)
+            return unexpected{error{this}};
+        return result;
+    }
+
+
+    unsigned
+    handle::meta_check()
+        noexcept
+    {
+        return mpg123_meta_check(raw);
+    }
+
+
+    id3
+    handle::get_id3()
+    {
+        auto result = try_get_id3();
+        if (!result)
+            throw result.error();
+        return std::move(*result);
+    }
+
+
+    expected<id3, error>
+    handle::try_get_id3()
+        noexcept
+    {
+        mpg123_id3v1* v1 = nullptr;
+        mpg123_id3v2* v2 = nullptr;
+        int e = mpg123_id3(raw, &v1, &v2);
+        if  (e != MPG123_OK)
+            return unexpected{error{this}};
+        // Converting the tags allocates; don't let bad_alloc escape a noexcept function.
+        try {
+            id3 result{ v1, v2 };
+            mpg123_meta_free(raw);
+            return result;
+        }
+        catch (std::bad_alloc&) {
+            return unexpected{error{MPG123_OUT_OF_MEM}};
+        }
+    }
+
+
+    pmr::id3
+    handle::get_id3(std::pmr::memory_resource* resource)
+    {
+        auto result = try_get_id3(resource);
+        if (!result)
+            throw result.error();
+        return std::move(*result);
+    }
+
+
+    expected<pmr::id3, error>
+    handle::try_get_id3(std::pmr::memory_resource* resource)
+        noexcept
+    {
+        if (!resource)
+            return unexpected{error{MPG123_NULL_POINTER}};
+        mpg123_id3v1* v1 = nullptr;
+        mpg123_id3v2* v2 = nullptr;
+        int e = mpg123_id3(raw, &v1, &v2);
+        if  (e != MPG123_OK)
+            return unexpected{error{this}};
+        // See try_get_id3() above.
+        try {
+            pmr::id3 result{ v1, v2, resource };
+            mpg123_meta_free(raw);
+            return result;
+        }
+        catch (std::bad_alloc&) {
+            return unexpected{error{MPG123_OUT_OF_MEM}};
+        }
     }
 
 } // namespace mpg123
@@ -5,6 +5,8 @@
  * SPDX-License-Identifier: LGPL-3.0-or-later
  */
 
+#include <utility>
+
 #include "mpg123xx/id3.hpp"
 
 #include "utils.hpp"
@@ -30,25 +32,40 @@ namespace mpg123 {
         }
 
 
-        template<std::size_t N>
-        std::string
-        array_to_str(const char (&src)[N])
+        template<typename Alloc,
+                 std::size_t N>
+        detail::basic_string<Alloc>
+        array_to_str(const char (&src)[N],
+                     const Alloc& alloc)
         {
             if (contains(src, '\0'))
-                return src;
+                return {src, alloc};
             else
-                return std::string(src, src + N);
+                return {src, src + N, alloc};
         }
 
     } // namespace
 
 
-    id3v1::id3v1(const mpg123_id3v1* src) :
-        title{array_to_str(src->title)},
-        artist{array_to_str(src->artist)},
-        album{array_to_str(src->album)},
-        year{array_to_str(src->year)},
-        comment{array_to_str(src->comment)},
+    template<typename Alloc>
+    basic_id3v1<Alloc>::basic_id3v1(const allocator_type& alloc)
+        noexcept :
+        title(alloc),
+        artist(alloc),
+        album(alloc),
+        year(alloc),
+        comment(alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_id3v1<Alloc>::basic_id3v1(const mpg123_id3v1* src,
+                                    const allocator_type& alloc) :
+        title{array_to_str(src->title, alloc)},
+        artist{array_to_str(src->artist, alloc)},
+        album{array_to_str(src->album, alloc)},
+        year{array_to_str(src->year, alloc)},
+        comment{array_to_str(src->comment, alloc)},
         genre{src->genre}
     {
         // Handle ID3v1.1
@@ -57,57 +74,261 @@ namespace mpg123 {
     }
 
 
-    text::text(const mpg123_text* src)
+    template<typename Alloc>
+    basic_id3v1<Alloc>::basic_id3v1(const basic_id3v1& other,
+                                    const allocator_type& alloc) :
+        title(other.title, alloc),
+        artist(other.artist, alloc),
+        album(other.album, alloc),
+        year(other.year, alloc),
+        comment(other.comment, alloc),
+        track{other.track},
+        genre{other.genre}
+    {}
+
+
+    template<typename Alloc>
+    basic_id3v1<Alloc>::basic_id3v1(basic_id3v1&& other,
+                                    const allocator_type& alloc) :
+        title(std::move(other.title), alloc),
+        artist(std::move(other.artist), alloc),
+        album(std::move(other.album), alloc),
+        year(std::move(other.year), alloc),
+        comment(std::move(other.comment), alloc),
+        track{other.track},
+        genre{other.genre}
+    {}
+
+
+    template<typename Alloc>
+    basic_text<Alloc>::basic_text(const allocator_type& alloc)
+        noexcept :
+        lang(alloc),
+        id(alloc),
+        description(alloc),
+        data(alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_text<Alloc>::basic_text(const mpg123_text* src,
+                                  const allocator_type& alloc) :
+        basic_text(alloc)
     {
         if (src) {
-            lang = array_to_str(src->lang);
-            id = array_to_str(src->id);
-            description = to_string(src->description);
-            data = to_string(src->text);
+            lang = array_to_str(src->lang, alloc);
+            id = array_to_str(src->id, alloc);
+            description = to_string(src->description, alloc);
+            data = to_string(src->text, alloc);
         }
     }
 
 
-    text::text(const mpg123_text& src) :
-        lang{array_to_str(src.lang)},
-        id{array_to_str(src.id)},
-        description{to_string(src.description)},
-        data{to_string(src.text)}
+    template<typename Alloc>
+    basic_text<Alloc>::basic_text(const mpg123_text& src,
+                                  const allocator_type& alloc) :
+        lang{array_to_str(src.lang, alloc)},
+        id{array_to_str(src.id, alloc)},
+        description{to_string(src.description, alloc)},
+        data{to_string(src.text, alloc)}
+    {}
+
+
+    template<typename Alloc>
+    basic_text<Alloc>::basic_text(const basic_text& other,
+                                  const allocator_type& alloc) :
+        lang(other.lang, alloc),
+        id(other.id, alloc),
+        description(other.description, alloc),
+        data(other.data, alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_text<Alloc>::basic_text(basic_text&& other,
+                                  const allocator_type& alloc) :
+        lang(std::move(other.lang), alloc),
+        id(std::move(other.id), alloc),
+        description(std::move(other.description), alloc),
+        data(std::move(other.data), alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_picture<Alloc>::basic_picture(const allocator_type& alloc)
+        noexcept :
+        description(alloc),
+        mime_type(alloc),
+        data(alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_picture<Alloc>::basic_picture(const mpg123_picture& src,
+                                        const allocator_type& alloc) :
+        type{static_cast<mpg123_id3_pic_type>(src.type)},
+        description{to_string(src.description, alloc)},
+        mime_type{to_string(src.mime_type, alloc)},
+        data(reinterpret_cast<const std::byte*>(src.data),
+             reinterpret_cast<const std::byte*>(src.data) + src.size,
+             alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_picture<Alloc>::basic_picture(const basic_picture& other,
+                                        const allocator_type& alloc) :
+        type{other.type},
+        description(other.description, alloc),
+        mime_type(other.mime_type, alloc),
+        data(other.data, alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_picture<Alloc>::basic_picture(basic_picture&& other,
+                                        const allocator_type& alloc) :
+        type{other.type},
+        description(std::move(other.description), alloc),
+        mime_type(std::move(other.mime_type), alloc),
+        data(std::move(other.data), alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_id3v2<Alloc>::basic_id3v2(const allocator_type& alloc)
+        noexcept :
+        title(alloc),
+        artist(alloc),
+        album(alloc),
+        year(alloc),
+        genre(alloc),
+        comment(alloc),
+        comments(alloc),
+        texts(alloc),
+        extras(alloc),
+        pictures(alloc)
     {}
 
 
-    id3v2::id3v2(const mpg123_id3v2* src) :
+    template<typename Alloc>
+    basic_id3v2<Alloc>::basic_id3v2(const mpg123_id3v2* src,
+                                    const allocator_type& alloc) :
         version{src->version},
-        title{to_string(src->title)},
-        artist{to_string(src->title)},
-        album{to_string(src->album)},
-        year{to_string(src->year)},
-        genre{to_string(src->genre)},
-        comment{to_string(src->comment)}
+        title{to_string(src->title, alloc)},
+        artist{to_string(src->artist, alloc)},
+        album{to_string(src->album, alloc)},
+        year{to_string(src->year, alloc)},
+        genre{to_string(src->genre, alloc)},
+        comment{to_string(src->comment, alloc)},
+        comments(alloc),
+        texts(alloc),
+        extras(alloc),
+        pictures(alloc)
     {
+        // Note: the vectors pass their allocator on to the elements.
+        comments.reserve(src->comments);
         for (std::size_t i = 0; i < src->comments; ++i)
-            comments.push_back(src->comment_list[i]);
+            comments.emplace_back(src->comment_list[i]);
 
+        texts.reserve(src->texts);
         for (std::size_t i = 0; i < src->texts; ++i)
-            texts.push_back(src->text[i]);
+            texts.emplace_back(src->text[i]);
 
+        extras.reserve(src->extras);
         for (std::size_t i = 0; i < src->extras; ++i)
-            extras.push_back(src->extra[i]);
-
-        // TODO: process pictures
+            extras.emplace_back(src->extra[i]);
 
+        pictures.reserve(src->pictures);
+        for (std::size_t i = 0; i < src->pictures; ++i)
+            pictures.emplace_back(src->picture[i]);
     }
 
 
-    id3::id3(mpg123_id3v1* tag1,
-             mpg123_id3v2* tag2)
+    template<typename Alloc>
+    basic_id3v2<Alloc>::basic_id3v2(const basic_id3v2& other,
+                                    const allocator_type& alloc) :
+        version{other.version},
+        title(other.title, alloc),
+        artist(other.artist, alloc),
+        album(other.album, alloc),
+        year(other.year, alloc),
+        genre(other.genre, alloc),
+        comment(other.comment, alloc),
+        comments(other.comments, alloc),
+        texts(other.texts, alloc),
+        extras(other.extras, alloc),
+        pictures(other.pictures, alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_id3v2<Alloc>::basic_id3v2(basic_id3v2&& other,
+                                    const allocator_type& alloc) :
+        version{other.version},
+        title(std::move(other.title), alloc),
+        artist(std::move(other.artist), alloc),
+        album(std::move(other.album), alloc),
+        year(std::move(other.year), alloc),
+        genre(std::move(other.genre), alloc),
+        comment(std::move(other.comment), alloc),
+        comments(std::move(other.comments), alloc),
+        texts(std::move(other.texts), alloc),
+        extras(std::move(other.extras), alloc),
+        pictures(std::move(other.pictures), alloc)
+    {}
+
+
+    template<typename Alloc>
+    basic_id3<Alloc>::basic_id3(const allocator_type&)
+        noexcept
+    {}
+
+
+    template<typename Alloc>
+    basic_id3<Alloc>::basic_id3(mpg123_id3v1* tag1,
+                                mpg123_id3v2* tag2,
+                                const allocator_type& alloc)
     {
         if (tag1)
-            v1.emplace(tag1);
+            v1.emplace(tag1, alloc);
         if (tag2)
-            v2.emplace(tag2);
+            v2.emplace(tag2, alloc);
     }
 
 
+    template<typename Alloc>
+    basic_id3<Alloc>::basic_id3(const basic_id3& other,
+                                const allocator_type& alloc)
+    {
+        if (other.v1)
+            v1.emplace(*other.v1, alloc);
+        if (other.v2)
+            v2.emplace(*other.v2, alloc);
+    }
+
+
+    template<typename Alloc>
+    basic_id3<Alloc>::basic_id3(basic_id3&& other,
+                                const allocator_type& alloc)
+    {
+        if (other.v1)
+            v1.emplace(std::move(*other.v1), alloc);
+        if (other.v2)
+            v2.emplace(std::move(*other.v2), alloc);
+    }
+
+
+    template struct basic_id3v1<std::allocator<char>>;
+    template struct basic_text<std::allocator<char>>;
+    template struct basic_picture<std::allocator<char>>;
+    template struct basic_id3v2<std::allocator<char>>;
+    template struct basic_id3<std::allocator<char>>;
+
+    template struct basic_id3v1<std::pmr::polymorphic_allocator<char>>;
+    template struct basic_text<std::pmr::polymorphic_allocator<char>>;
+    template struct basic_picture<std::pmr::polymorphic_allocator<char>>;
+    template struct basic_id3v2<std::pmr::polymorphic_allocator<char>>;
+    template struct basic_id3<std::pmr::polymorphic_allocator<char>>;
 
 } // namespace mpg123
@@ -0,0 +1,464 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "mpg123xx/loudness.hpp"
+
+#include "mpg123xx/format.hpp"
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        constexpr double absolute_gate = -70.0; // LUFS
+        constexpr double integrated_gate = -10.0; // LU below the ungated mean
+        constexpr double range_gate = -20.0;
+
+        constexpr unsigned max_factor = 4; // true peak oversampling
+
+
+        double
+        to_lufs(double mean_square)
+            noexcept
+        {
+            return -0.691 + 10.0 * std::log10(mean_square);
+        }
+
+
+        double
+        from_lufs(double lufs)
+            noexcept
+        {
+            return std::pow(10.0, (lufs + 0.691) / 10.0);
+        }
+
+
+        // Mean of the blocks louder than the threshold; 0 if there are none.
+        double
+        gated_mean(const std::vector<double>& blocks,
+                   double threshold)
+            noexcept
+        {
+            double sum = 0;
+            std::size_t n = 0;
+            for (double z : blocks)
+                if (z > threshold) {
+                    sum += z;
+                    ++n;
+                }
+            return n ? sum / n : 0.0;
+        }
+
+
+        // BS.1770 K-weighting, from the analog prototypes, so any rate works.
+
+        std::array<double, 5>
+        shelf_filter(long rate)
+            noexcept
+        {
+            const double f0 = 1681.974450955533;
+            const double gain = 3.999843853973347;
+            const double q = 0.7071752369554196;
+            const double k = std::tan(std::numbers::pi * f0 / rate);
+            const double vh = std::pow(10.0, gain / 20.0);
+            const double vb = std::pow(vh, 0.4996667741545416);
+            const double a0 = 1.0 + k / q + k * k;
+            return {
+                (vh + vb * k / q + k * k) / a0,
+                2.0 * (k * k - vh) / a0,
+                (vh - vb * k / q + k * k) / a0,
+                2.0 * (k * k - 1.0) / a0,
+                (1.0 - k / q + k * k) / a0
+            };
+        }
+
+
+        std::array<double, 5>
+        highpass_filter(long rate)
+            noexcept
+        {
+            const double f0 = 38.13547087602444;
+            const double q = 0.5003270373238773;
+            const double k = std::tan(std::numbers::pi * f0 / rate);
+            const double a0 = 1.0 + k / q + k * k;
+            return {
+                1.0,
+                -2.0,
+                1.0,
+                2.0 * (k * k - 1.0) / a0,
+                (1.0 - k / q + k * k) / a0
+            };
+        }
+
+
+        loudness_meter
+        measure(handle& h)
+        {
+            std::optional<loudness_meter> meter;
+            std::optional<loudness_meter> done;
+            for (;;) {
+                auto f = h.try_decode_frame();
+                if (!f) {
+                    if (f.error().code == MPG123_NEW_FORMAT) {
+                        // Keep what was measured so far, and start over with the
+                        // new format.
+                        if (meter) {
+                            if (done)
+                                done->merge(*meter);
+                            else
+                                done = std::move(meter);
+                            meter.reset();
+                        }
+                        continue;
+                    }
+                    if (f.error().code == MPG123_DONE)
+                        break;
+                    throw f.error();
+                }
+                if (!meter) {
+                    const format fmt = h.get_format();
+                    if (fmt.encoding != MPG123_ENC_FLOAT_32)
+                        throw std::invalid_argument{"loudness analysis needs float32 output"};
+                    meter.emplace(fmt.rate, fmt.channels);
+                }
+                meter->process({ reinterpret_cast<const float*>(f->samples.data()),
+                                 f->samples.size() / sizeof(float) });
+            }
+            if (done) {
+                if (meter)
+                    done->merge(*meter);
+                return std::move(*done);
+            }
+            if (meter)
+                return std::move(*meter);
+            // Nothing decoded.
+            return loudness_meter{44100, 2};
+        }
+
+
+        handle
+        open_float(const path& filename)
+        {
+            handle h;
+            h.format_none();
+            for (long rate : supported_rates())
+                h.set_format(rate, MPG123_MONO | MPG123_STEREO, MPG123_ENC_FLOAT_32);
+            h.open(filename);
+            return h;
+        }
+
+    } // namespace
+
+
+    loudness_meter::loudness_meter(long rate,
+                                   unsigned channels) :
+        rate{rate},
+        channels{channels},
+        shelf{shelf_filter(rate)},
+        highpass{highpass_filter(rate)},
+        state(4 * channels),
+        step_len{static_cast<std::size_t>(std::max(rate / 10, 1l))},
+        factor{rate < 96000 ? 4u : rate < 192000 ? 2u : 1u},
+        taps{factor > 1 ? 12u : 1u}
+    {
+        if (channels != 1 && channels != 2)
+            throw std::invalid_argument{"loudness_meter only supports mono or stereo"};
+        if (rate <= 0)
+            throw std::invalid_argument{"invalid sample rate"};
+
+        if (factor > 1) {
+            // Windowed-sinc interpolator, cut off at the original Nyquist
+            // frequency, split into phases; each phase is normalized to unity
+            // gain.
+            const unsigned n = factor * taps;
+            const double center = (n - 1) / 2.0;
+            std::vector<double> h(n);
+            for (unsigned i = 0; i < n; ++i) {
+                const double x = (i - center) / factor;
+                const double sinc = x == 0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+                const double w = 0.42
+                    - 0.5 * std::cos(2 * std::numbers::pi * i / (n - 1))
+                    + 0.08 * std::cos(4 * std::numbers::pi * i / (n - 1));
+                h[i] = sinc * w;
+            }
+            // Laid out as coeffs[j * max_factor + p]: tap j of phase p, with tap 0
+            // applied to the oldest sample. Unused phases stay 0.
+            coeffs.resize(taps * max_factor);
+            for (unsigned p = 0; p < factor; ++p) {
+                double sum = 0;
+                for (unsigned k = 0; k < taps; ++k)
+                    sum += h[k * factor + p];
+                for (unsigned j = 0; j < taps; ++j)
+                    coeffs[j * max_factor + p] = h[(taps - 1 - j) * factor + p] / sum;
+            }
+            history.resize(2 * taps * channels);
+        }
+    }
+
+
+    // Note: the recursion can't be vectorized along time, so the channels are
+    // the lanes; the loop over c is unrolled and runs both channels at once.
+    template<unsigned C>
+    void
+    loudness_meter::weigh(const float* in,
+                          std::size_t frames)
+    {
+        const auto [s0, s1, s2, s3, s4] = shelf;
+        const auto [h0, h1, h2, h3, h4] = highpass;
+        while (frames) {
+            const std::size_t n = std::min(frames, step_len - step_fill);
+            double z1[C], z2[C], z3[C], z4[C];
+            double sum[C];
+            for (unsigned c = 0; c < C; ++c) {
+                z1[c] = state[4 * c + 0];
+                z2[c] = state[4 * c + 1];
+                z3[c] = state[4 * c + 2];
+                z4[c] = state[4 * c + 3];
+                sum[c] = 0;
+            }
+            for (std::size_t f = 0; f < n; ++f)
+                for (unsigned c = 0; c < C; ++c) {
+                    // Transposed direct form II.
+                    const double x = in[f * C + c];
+                    const double y1 = s0 * x + z1[c];
+                    z1[c] = s1 * x - s3 * y1 + z2[c];
+                    z2[c] = s2 * x - s4 * y1;
+                    const double y2 = h0 * y1 + z3[c];
+                    z3[c] = h1 * y1 - h3 * y2 + z4[c];
+                    z4[c] = h2 * y1 - h4 * y2;
+                    sum[c] += y2 * y2;
+                }
+            for (unsigned c = 0; c < C; ++c) {
+                state[4 * c + 0] = z1[c];
+                state[4 * c + 1] = z2[c];
+                state[4 * c + 2] = z3[c];
+                state[4 * c + 3] = z4[c];
+                // All channel weights are 1 for mono and stereo.
+                step_sum += sum[c];
+            }
+            in += n * C;
+            frames -= n;
+            step_fill += n;
+            if (step_fill == step_len)
+                end_step();
+        }
+    }
+
+
+    void
+    loudness_meter::oversample(const float* in,
+                               std::size_t frames)
+    {
+        float peak = 0;
+        for (std::size_t f = 0; f < frames; ++f) {
+            hist_pos = hist_pos + 1 == taps ? 0 : hist_pos + 1;
+            for (unsigned c = 0; c < channels; ++c) {
+                // Each sample is stored twice, so the last taps samples are always
+                // contiguous, starting at hist_pos + 1.
+                float* hist = history.data() + c * 2 * taps;
+                hist[hist_pos] = hist[hist_pos + taps] = in[f * channels + c];
+                const float* window = hist + hist_pos + 1;
+                // The phases are independent accumulators, so this vectorizes.
+                float acc[max_factor] = {};
+                for (unsigned j = 0; j < taps; ++j)
+                    for (unsigned p = 0; p < max_factor; ++p)
+                        acc[p] += coeffs[j * max_factor + p] * window[j];
+                for (unsigned p = 0; p < factor; ++p)
+                    peak = std::max(peak, std::abs(acc[p]));
+            }
+        }
+        true_peak = std::max<double>(true_peak, peak);
+    }
+
+
+    void
+    loudness_meter::end_step()
+    {
+        recent_steps[num_steps % recent_steps.size()] = step_sum;
+        ++num_steps;
+        step_sum = 0;
+        step_fill = 0;
+
+        if (num_steps >= 4) {
+            double sum = 0;
+            for (std::size_t i = num_steps - 4; i < num_steps; ++i)
+                sum += recent_steps[i % recent_steps.size()];
+            momentary.push_back(sum / (4 * step_len));
+        }
+        if (num_steps >= recent_steps.size()) {
+            double sum = std::accumulate(recent_steps.begin(), recent_steps.end(), 0.0);
+            short_term.push_back(sum / (recent_steps.size() * step_len));
+        }
+    }
+
+
+    void
+    loudness_meter::process(std::span<const float> samples)
+    {
+        const std::size_t frames = samples.size() / channels;
+        if (!frames)
+            return;
+
+        float peak = 0;
+        for (float x : samples.first(frames * channels))
+            peak = std::max(peak, std::abs(x));
+        sample_peak = std::max<double>(sample_peak, peak);
+
+        if (factor > 1)
+            oversample(samples.data(), frames);
+        else
+            true_peak = sample_peak;
+
+        if (channels == 2)
+            weigh<2>(samples.data(), frames);
+        else
+            weigh<1>(samples.data(), frames);
+    }
+
+
+    loudness
+    loudness_meter::result()
+        const
+    {
+        loudness r;
+        r.true_peak = std::max(true_peak, sample_peak);
+        r.sample_peak = sample_peak;
+
+        const double abs_threshold = from_lufs(absolute_gate);
+
+        // Integrated: absolute gate, then relative to the mean of what's left.
+        if (double mean = gated_mean(momentary, abs_threshold); mean > 0) {
+            const double rel_threshold = from_lufs(to_lufs(mean) + integrated_gate);
+            r.integrated = to_lufs(gated_mean(momentary, std::max(abs_threshold, rel_threshold)));
+        }
+
+        // Range: spread between the 10th and 95th percentiles of the gated
+        // short-term loudness.
+        if (double mean = gated_mean(short_term, abs_threshold); mean > 0) {
+            const double threshold = std::max(abs_threshold,
+                                              from_lufs(to_lufs(mean) + range_gate));
+            std::vector<double> levels;
+            for (double z : short_term)
+                if (z > threshold)
+                    levels.push_back(to_lufs(z));
+            if (levels.size() > 1) {
+                std::ranges::sort(levels);
+                auto percentile = [&levels](double p)
+                {
+                    return levels[std::lround((levels.size() - 1) * p)];
+                };
+                r.range = percentile(0.95) - percentile(0.10);
+            }
+        }
+        return r;
+    }
+
+
+    void
+    loudness_meter::merge(const loudness_meter& other)
+    {
+        momentary.insert(momentary.end(), other.momentary.begin(), other.momentary.end());
+        short_term.insert(short_term.end(), other.short_term.begin(), other.short_term.end());
+        true_peak = std::max(true_peak, other.true_peak);
+        sample_peak = std::max(sample_peak, other.sample_peak);
+    }
+
+
+    void
+    loudness_meter::reset()
+        noexcept
+    {
+        std::ranges::fill(state, 0.0);
+        std::ranges::fill(history, 0.0f);
+        hist_pos = 0;
+        step_fill = 0;
+        step_sum = 0;
+        recent_steps = {};
+        num_steps = 0;
+        momentary.clear();
+        short_term.clear();
+        true_peak = 0;
+        sample_peak = 0;
+    }
+
+
+    loudness
+    analyze_loudness(handle& h)
+    {
+        return measure(h).result();
+    }
+
+
+    loudness
+    analyze_loudness(const path& filename)
+    {
+        handle h = open_float(filename);
+        return analyze_loudness(h);
+    }
+
+
+    album_loudness
+    analyze_album(std::span<const path> files,
+                  unsigned threads)
+    {
+        if (!threads)
+            threads = std::thread::hardware_concurrency();
+        threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(files.size(), 1));
+
+        std::vector<std::optional<loudness_meter>> meters(files.size());
+        std::vector<std::exception_ptr> errors(files.size());
+        std::atomic_size_t next = 0;
+        auto work = [&]
+        {
+            for (std::size_t i; (i = next++) < files.size();) {
+                try {
+                    handle h = open_float(files[i]);
+                    meters[i] = measure(h);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(threads - 1);
+            for (unsigned i = 1; i < threads; ++i)
+                workers.emplace_back(work);
+            work();
+        }
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+
+        album_loudness result;
+        result.tracks.reserve(files.size());
+        std::optional<loudness_meter> album;
+        for (auto& m : meters) {
+            result.tracks.push_back(m->result());
+            if (album)
+                album->merge(*m);
+            else
+                album = std::move(*m);
+        }
+        if (album)
+            result.album = album->result();
+        return result;
+    }
+
+} // namespace mpg123
@@ -0,0 +1,424 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mpg123xx/metadata_cache.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+#include "utils.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // On-disk layout, in native byte order: a header, then the records
+        // sorted by (dev, ino), then the string data.
+
+        constexpr char cache_magic[8] = { 'M', 'P', 'G', '1', '2', '3', 'M', 'C' };
+        constexpr std::uint32_t cache_version = 1;
+
+        constexpr std::size_t num_strings = 6;
+
+
+        struct file_header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t record_size;
+            std::uint64_t count;
+            std::uint64_t strings_offset;
+            std::uint64_t strings_size;
+        };
+
+
+        struct string_ref {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+
+        struct record {
+            file_key key;
+            std::int64_t rate;
+            std::uint32_t channels;
+            std::uint32_t encoding;
+            std::int64_t length;
+            std::int32_t enc_delay;
+            std::int32_t enc_padding;
+            std::array<string_ref, num_strings> strings;
+        };
+
+        static_assert(sizeof(file_header) % 8 == 0);
+        static_assert(sizeof(record) % 8 == 0);
+
+
+        bool
+        key_less(const file_key& a,
+                 const file_key& b)
+            noexcept
+        {
+            return std::pair{a.dev, a.ino} < std::pair{b.dev, b.ino};
+        }
+
+
+        std::array<std::string*, num_strings>
+        string_fields(metadata& m)
+            noexcept
+        {
+            return { &m.title, &m.artist, &m.album, &m.year, &m.genre, &m.comment };
+        }
+
+
+        void
+        pick(std::string& dst,
+             const std::string& v2,
+             const std::string& v1)
+        {
+            dst = v2.empty() ? v1 : v2;
+        }
+
+    } // namespace
+
+
+    metadata
+    metadata::from_file(const path& filename)
+    {
+        handle h;
+        h.open(filename);
+        return from_handle(h);
+    }
+
+
+    metadata
+    metadata::from_handle(handle& h)
+    {
+        metadata result;
+        result.fmt = h.get_format();
+        if (auto len = h.try_length())
+            result.length = *len;
+        if (auto delay = h.try_get_state(MPG123_ENC_DELAY))
+            result.enc_delay = *delay;
+        if (auto padding = h.try_get_state(MPG123_ENC_PADDING))
+            result.enc_padding = *padding;
+
+        if (h.meta_check() & MPG123_ID3) {
+            auto tags = h.get_id3();
+            const id3v1 v1 = tags.v1.value_or(id3v1{});
+            const id3v2 v2 = tags.v2.value_or(id3v2{});
+            pick(result.title, v2.title, v1.title);
+            pick(result.artist, v2.artist, v1.artist);
+            pick(result.album, v2.album, v1.album);
+            pick(result.year, v2.year, v1.year);
+            pick(result.comment, v2.comment, v1.comment);
+            result.genre = v2.genre;
+            if (result.genre.empty() && tags.v1 && v1.genre != 255)
+                result.genre = std::to_string(v1.genre);
+        }
+        return result;
+    }
+
+
+    std::optional<file_key>
+    file_key::from_file(const path& filename)
+        noexcept
+    {
+        struct ::stat st;
+        if (::stat(filename.c_str(), &st) < 0)
+            return {};
+        return file_key{
+            .dev = static_cast<std::uint64_t>(st.st_dev),
+            .ino = static_cast<std::uint64_t>(st.st_ino),
+            .size = static_cast<std::uint64_t>(st.st_size),
+            .mtime_ns = st.st_mtim.tv_sec * std::int64_t{1000000000} + st.st_mtim.tv_nsec
+        };
+    }
+
+
+    metadata_cache::metadata_cache(const path& filename)
+    {
+        open(filename);
+    }
+
+
+    metadata_cache::metadata_cache(metadata_cache&& other)
+        noexcept :
+        base{std::exchange(other.base, nullptr)},
+        mapped_size{std::exchange(other.mapped_size, 0)},
+        count{std::exchange(other.count, 0)},
+        records{std::exchange(other.records, nullptr)},
+        strings{std::exchange(other.strings, nullptr)},
+        strings_size{std::exchange(other.strings_size, 0)}
+    {}
+
+
+    metadata_cache&
+    metadata_cache::operator =(metadata_cache&& other)
+        noexcept
+    {
+        if (this != &other) {
+            close();
+            base = std::exchange(other.base, nullptr);
+            mapped_size = std::exchange(other.mapped_size, 0);
+            count = std::exchange(other.count, 0);
+            records = std::exchange(other.records, nullptr);
+            strings = std::exchange(other.strings, nullptr);
+            strings_size = std::exchange(other.strings_size, 0);
+        }
+        return *this;
+    }
+
+
+    metadata_cache::~metadata_cache()
+        noexcept
+    {
+        close();
+    }
+
+
+    void
+    metadata_cache::open(const path& filename)
+    {
+        close();
+
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT)
+                return;
+            throw std::system_error{errno, std::generic_category(), "open()"};
+        }
+        struct ::stat st;
+        if (::fstat(fd, &st) < 0) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error{e, std::generic_category(), "fstat()"};
+        }
+        const std::size_t file_size = st.st_size;
+        if (file_size < sizeof(file_header)) {
+            ::close(fd);
+            return;
+        }
+        void* addr = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throw std::system_error{errno, std::generic_category(), "mmap()"};
+        base = static_cast<const std::byte*>(addr);
+        mapped_size = file_size;
+
+        file_header header;
+        std::memcpy(&header, base, sizeof header);
+        const std::uint64_t records_end = sizeof header + header.count * sizeof(record);
+        if (std::memcmp(header.magic, cache_magic, sizeof cache_magic)
+            || header.version != cache_version
+            || header.record_size != sizeof(record)
+            || header.count > file_size / sizeof(record)
+            || records_end > header.strings_offset
+            || header.strings_offset > file_size
+            || header.strings_size > file_size - header.strings_offset) {
+            // Unusable file, treat as empty.
+            close();
+            return;
+        }
+        count = header.count;
+        records = base + sizeof header;
+        strings = reinterpret_cast<const char*>(base + header.strings_offset);
+        strings_size = header.strings_size;
+        ::madvise(const_cast<std::byte*>(base), mapped_size, MADV_RANDOM);
+    }
+
+
+    void
+    metadata_cache::close()
+        noexcept
+    {
+        if (base)
+            ::munmap(const_cast<std::byte*>(base), mapped_size);
+        base = nullptr;
+        mapped_size = 0;
+        count = 0;
+        records = nullptr;
+        strings = nullptr;
+        strings_size = 0;
+    }
+
+
+    std::optional<metadata>
+    metadata_cache::find(const file_key& key)
+        const
+    {
+        std::size_t lo = 0;
+        std::size_t hi = count;
+        record rec;
+        while (lo < hi) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            std::memcpy(&rec, records + mid * sizeof(record), sizeof rec);
+            if (key_less(rec.key, key))
+                lo = mid + 1;
+            else if (key_less(key, rec.key))
+                hi = mid;
+            else {
+                // Same file, but it may have changed since.
+                if (rec.key != key)
+                    return {};
+                metadata result;
+                result.fmt = format{
+                    .rate = static_cast<long>(rec.rate),
+                    .channels = rec.channels,
+                    .encoding = rec.encoding
+                };
+                result.length = rec.length;
+                result.enc_delay = rec.enc_delay;
+                result.enc_padding = rec.enc_padding;
+                auto fields = string_fields(result);
+                for (std::size_t i = 0; i < num_strings; ++i) {
+                    auto [offset, size] = rec.strings[i];
+                    if (std::uint64_t{offset} + size > strings_size)
+                        return {};
+                    fields[i]->assign(strings + offset, size);
+                }
+                return result;
+            }
+        }
+        return {};
+    }
+
+
+    std::optional<metadata>
+    metadata_cache::find(const path& filename)
+        const
+    {
+        auto key = file_key::from_file(filename);
+        if (!key)
+            return {};
+        return find(*key);
+    }
+
+
+    std::size_t
+    metadata_cache::size()
+        const noexcept
+    {
+        return count;
+    }
+
+
+    metadata_cache_writer::metadata_cache_writer(const path& filename) :
+        filename{filename}
+    {}
+
+
+    void
+    metadata_cache_writer::add(const file_key& key,
+                               metadata meta)
+    {
+        entries.emplace_back(key, std::move(meta));
+    }
+
+
+    std::optional<metadata>
+    metadata_cache_writer::update(const metadata_cache& old,
+                                  const path& filename)
+    {
+        auto key = file_key::from_file(filename);
+        if (!key)
+            return {};
+        auto meta = old.find(*key);
+        if (!meta) {
+            try {
+                meta = metadata::from_file(filename);
+            }
+            catch (std::exception&) {
+                return {};
+            }
+        }
+        add(*key, *meta);
+        return meta;
+    }
+
+
+    std::size_t
+    metadata_cache_writer::size()
+        const noexcept
+    {
+        return entries.size();
+    }
+
+
+    void
+    metadata_cache_writer::commit()
+    {
+        std::ranges::stable_sort(entries, key_less, &std::pair<file_key, metadata>::first);
+        // When a file was added twice, keep the last entry.
+        std::vector<std::pair<file_key, metadata>> unique;
+        unique.reserve(entries.size());
+        for (auto& e : entries) {
+            if (!unique.empty()
+                && !key_less(unique.back().first, e.first)
+                && !key_less(e.first, unique.back().first))
+                unique.back() = std::move(e);
+            else
+                unique.push_back(std::move(e));
+        }
+        entries = std::move(unique);
+
+        std::vector<record> recs;
+        recs.reserve(entries.size());
+        std::string blob;
+        for (auto& [key, meta] : entries) {
+            record rec{};
+            rec.key = key;
+            rec.rate = meta.fmt.rate;
+            rec.channels = meta.fmt.channels;
+            rec.encoding = meta.fmt.encoding;
+            rec.length = meta.length;
+            rec.enc_delay = meta.enc_delay;
+            rec.enc_padding = meta.enc_padding;
+            auto fields = string_fields(meta);
+            for (std::size_t i = 0; i < num_strings; ++i) {
+                if (blob.size() + fields[i]->size() > std::numeric_limits<std::uint32_t>::max())
+                    throw std::length_error{"metadata cache strings exceed 4 GiB"};
+                rec.strings[i] = string_ref{
+                    .offset = static_cast<std::uint32_t>(blob.size()),
+                    .size = static_cast<std::uint32_t>(fields[i]->size())
+                };
+                blob += *fields[i];
+            }
+            recs.push_back(rec);
+        }
+
+        file_header header{};
+        std::memcpy(header.magic, cache_magic, sizeof cache_magic);
+        header.version = cache_version;
+        header.record_size = sizeof(record);
+        header.count = recs.size();
+        header.strings_offset = sizeof header + recs.size() * sizeof(record);
+        header.strings_size = blob.size();
+
+        utils::replace_file(filename,
+                            {
+                                std::as_bytes(std::span{&header, 1}),
+                                std::as_bytes(std::span{recs}),
+                                std::as_bytes(std::span{blob.data(), blob.size()})
+                            });
+    }
+
+} // namespace mpg123
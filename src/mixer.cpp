@@ -0,0 +1,261 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "mpg123xx/mixer.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // Note: these are plain loops over contiguous floats, so the compiler
+        // vectorizes them for whatever SIMD the target has.
+
+        void
+        mix_constant(float* out,
+                     const float* in,
+                     std::size_t count,
+                     float gain)
+            noexcept
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] += in[i] * gain;
+        }
+
+
+        void
+        mix_ramp(float* out,
+                 const float* in,
+                 std::size_t frames,
+                 unsigned channels,
+                 float gain,
+                 float step)
+            noexcept
+        {
+            if (channels == 2) {
+                for (std::size_t f = 0; f < frames; ++f) {
+                    const float g = gain + step * f;
+                    out[2 * f + 0] += in[2 * f + 0] * g;
+                    out[2 * f + 1] += in[2 * f + 1] * g;
+                }
+            } else {
+                for (std::size_t f = 0; f < frames; ++f)
+                    out[f] += in[f] * (gain + step * f);
+            }
+        }
+
+    } // namespace
+
+
+    mixer::mixer() :
+        mixer{options{}}
+    {}
+
+
+    mixer::mixer(const options& opts) :
+        opts{opts}
+    {
+        if (opts.channels != 1 && opts.channels != 2)
+            throw std::invalid_argument{"mixer only supports mono or stereo output"};
+        if (!opts.block_frames)
+            throw std::invalid_argument{"mixer block size can't be zero"};
+        output = std::make_unique<float[]>(block_samples());
+    }
+
+
+    void
+    mixer::configure(handle& h)
+        const
+    {
+        h.format_none();
+        h.set_format(opts.rate, opts.channels, MPG123_ENC_FLOAT_32);
+    }
+
+
+    mixer::input_id
+    mixer::add_file(const path& filename,
+                    float gain)
+    {
+        handle h;
+        configure(h);
+        h.open(filename);
+        return add(std::move(h), gain);
+    }
+
+
+    mixer::input_id
+    mixer::add(handle&& h,
+               float gain)
+    {
+        auto fmt = h.get_format();
+        if (fmt.rate != opts.rate
+            || fmt.channels != opts.channels
+            || fmt.encoding != MPG123_ENC_FLOAT_32)
+            throw std::invalid_argument{"handle output doesn't match the mixer format: "
+                                        + to_string(fmt)};
+        inputs.push_back(input{
+                .h = std::move(h),
+                .buffer = std::make_unique<float[]>(block_samples()),
+                .gain = gain,
+                .target = gain
+            });
+        return inputs.size() - 1;
+    }
+
+
+    std::size_t
+    mixer::size()
+        const noexcept
+    {
+        return inputs.size();
+    }
+
+
+    handle&
+    mixer::get_handle(input_id id)
+        noexcept
+    {
+        return inputs[id].h;
+    }
+
+
+    void
+    mixer::set_gain(input_id id,
+                    float gain)
+        noexcept
+    {
+        auto& in = inputs[id];
+        in.gain = in.target = gain;
+        in.step = 0;
+        in.ramp = 0;
+    }
+
+
+    float
+    mixer::get_gain(input_id id)
+        const noexcept
+    {
+        return inputs[id].gain;
+    }
+
+
+    void
+    mixer::fade(input_id id,
+                float target,
+                std::size_t frames)
+        noexcept
+    {
+        auto& in = inputs[id];
+        if (!frames) {
+            set_gain(id, target);
+            return;
+        }
+        in.target = target;
+        in.step = (target - in.gain) / frames;
+        in.ramp = frames;
+    }
+
+
+    bool
+    mixer::finished(input_id id)
+        const noexcept
+    {
+        return inputs[id].done;
+    }
+
+
+    std::optional<error>
+    mixer::get_error(input_id id)
+        const
+    {
+        return inputs[id].failure;
+    }
+
+
+    std::span<const float>
+    mixer::mix()
+    {
+        const std::size_t samples = block_samples();
+        std::fill_n(output.get(), samples, 0.0f);
+
+        for (auto& in : inputs) {
+            if (in.done)
+                continue;
+            decode(in);
+
+            std::size_t offset = 0; // in frames
+            if (in.ramp) {
+                const std::size_t n = std::min(in.ramp, opts.block_frames);
+                mix_ramp(output.get(),
+                         in.buffer.get(),
+                         n,
+                         opts.channels,
+                         in.gain,
+                         in.step);
+                in.ramp -= n;
+                in.gain = in.ramp ? in.gain + in.step * n : in.target;
+                offset = n;
+            }
+            if (offset < opts.block_frames && in.gain != 0.0f)
+                mix_constant(output.get() + offset * opts.channels,
+                             in.buffer.get() + offset * opts.channels,
+                             samples - offset * opts.channels,
+                             in.gain);
+        }
+
+        return {output.get(), samples};
+    }
+
+
+    const mixer::options&
+    mixer::get_options()
+        const noexcept
+    {
+        return opts;
+    }
+
+
+    std::size_t
+    mixer::block_samples()
+        const noexcept
+    {
+        return opts.block_frames * opts.channels;
+    }
+
+
+    void
+    mixer::decode(input& in)
+    {
+        const std::size_t total = block_samples() * sizeof(float);
+        auto dst = reinterpret_cast<std::byte*>(in.buffer.get());
+        std::size_t filled = 0;
+        while (filled < total) {
+            auto result = in.h.try_read(dst + filled, total - filled);
+            if (!result) {
+                if (result.error().code == MPG123_NEW_FORMAT)
+                    continue; // the format table only allows the mixer's format
+                // A broken input goes silent, without stopping the others.
+                if (result.error().code != MPG123_DONE)
+                    in.failure = result.error();
+                in.done = true;
+                break;
+            }
+            if (!*result) {
+                in.done = true;
+                break;
+            }
+            filled += *result;
+        }
+        // Pad a partial last block with silence.
+        std::fill(dst + filled, dst + total, std::byte{0});
+    }
+
+} // namespace mpg123
@@ -0,0 +1,437 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "mpg123xx/pcm_hash.hpp"
+
+#include "mpg123xx/format.hpp"
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        constexpr std::uint64_t p1 = 11400714785074694791ull;
+        constexpr std::uint64_t p2 = 14029467366897019727ull;
+        constexpr std::uint64_t p3 = 1609587929392839161ull;
+        constexpr std::uint64_t p4 = 9650029242287828579ull;
+        constexpr std::uint64_t p5 = 2870177450012600261ull;
+
+
+        template<typename T>
+        T
+        load_le(const std::byte* p)
+            noexcept
+        {
+            T v;
+            std::memcpy(&v, p, sizeof v);
+            if constexpr (std::endian::native == std::endian::big)
+                v = std::byteswap(v);
+            return v;
+        }
+
+
+        std::uint64_t
+        xxh_round(std::uint64_t acc,
+                  std::uint64_t input)
+            noexcept
+        {
+            acc += input * p2;
+            acc = std::rotl(acc, 31);
+            return acc * p1;
+        }
+
+
+        std::uint64_t
+        xxh_merge(std::uint64_t acc,
+                  std::uint64_t val)
+            noexcept
+        {
+            acc ^= xxh_round(0, val);
+            return acc * p1 + p4;
+        }
+
+
+        constexpr std::uint32_t sha_k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+
+        void
+        sha_block(std::uint32_t* h,
+                  const std::byte* block)
+            noexcept
+        {
+            std::uint32_t w[64];
+            for (int i = 0; i < 16; ++i) {
+                std::uint32_t v;
+                std::memcpy(&v, block + 4 * i, sizeof v);
+                if constexpr (std::endian::native == std::endian::little)
+                    v = std::byteswap(v);
+                w[i] = v;
+            }
+            for (int i = 16; i < 64; ++i) {
+                const auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+            std::uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+            for (int i = 0; i < 64; ++i) {
+                const auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+                const auto ch = (e & f) ^ (~e & g);
+                const auto t1 = k + s1 + ch + sha_k[i] + w[i];
+                const auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+                const auto maj = (a & b) ^ (a & c) ^ (b & c);
+                const auto t2 = s0 + maj;
+                k = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+            h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+        }
+
+
+        std::string
+        to_hex(std::span<const std::uint8_t> bytes)
+        {
+            constexpr char digits[] = "0123456789abcdef";
+            std::string result;
+            result.reserve(2 * bytes.size());
+            for (auto b : bytes) {
+                result += digits[b >> 4];
+                result += digits[b & 0xf];
+            }
+            return result;
+        }
+
+    } // namespace
+
+
+    namespace detail {
+
+        xxh64_state::xxh64_state(std::uint64_t seed)
+            noexcept :
+            seed{seed},
+            acc{ seed + p1 + p2, seed + p2, seed, seed - p1 }
+        {}
+
+
+        void
+        xxh64_state::update(std::span<const std::byte> data)
+            noexcept
+        {
+            total += data.size();
+            auto p = data.data();
+            auto end = p + data.size();
+
+            if (buf_size + data.size() < sizeof buf) {
+                std::memcpy(buf + buf_size, p, data.size());
+                buf_size += data.size();
+                return;
+            }
+            if (buf_size) {
+                const std::size_t fill = sizeof buf - buf_size;
+                std::memcpy(buf + buf_size, p, fill);
+                for (int i = 0; i < 4; ++i)
+                    acc[i] = xxh_round(acc[i], load_le<std::uint64_t>(buf + 8 * i));
+                p += fill;
+                buf_size = 0;
+            }
+            for (; end - p >= 32; p += 32)
+                for (int i = 0; i < 4; ++i)
+                    acc[i] = xxh_round(acc[i], load_le<std::uint64_t>(p + 8 * i));
+            buf_size = end - p;
+            std::memcpy(buf, p, buf_size);
+        }
+
+
+        std::uint64_t
+        xxh64_state::digest()
+            const noexcept
+        {
+            std::uint64_t h;
+            if (total >= 32) {
+                h = std::rotl(acc[0], 1) + std::rotl(acc[1], 7)
+                    + std::rotl(acc[2], 12) + std::rotl(acc[3], 18);
+                for (int i = 0; i < 4; ++i)
+                    h = xxh_merge(h, acc[i]);
+            } else
+                h = seed + p5;
+            h += total;
+
+            auto p = buf;
+            auto end = buf + buf_size;
+            for (; end - p >= 8; p += 8) {
+                h ^= xxh_round(0, load_le<std::uint64_t>(p));
+                h = std::rotl(h, 27) * p1 + p4;
+            }
+            if (end - p >= 4) {
+                h ^= load_le<std::uint32_t>(p) * p1;
+                h = std::rotl(h, 23) * p2 + p3;
+                p += 4;
+            }
+            for (; p < end; ++p) {
+                h ^= std::to_integer<std::uint64_t>(*p) * p5;
+                h = std::rotl(h, 11) * p1;
+            }
+
+            h ^= h >> 33;
+            h *= p2;
+            h ^= h >> 29;
+            h *= p3;
+            h ^= h >> 32;
+            return h;
+        }
+
+
+        sha256_state::sha256_state()
+            noexcept :
+            h{
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+            }
+        {}
+
+
+        void
+        sha256_state::update(std::span<const std::byte> data)
+            noexcept
+        {
+            total += data.size();
+            auto p = data.data();
+            auto end = p + data.size();
+            if (buf_size) {
+                const std::size_t fill = std::min<std::size_t>(sizeof buf - buf_size, end - p);
+                std::memcpy(buf + buf_size, p, fill);
+                buf_size += fill;
+                p += fill;
+                if (buf_size < sizeof buf)
+                    return;
+                sha_block(h, buf);
+                buf_size = 0;
+            }
+            for (; end - p >= 64; p += 64)
+                sha_block(h, p);
+            buf_size = end - p;
+            std::memcpy(buf, p, buf_size);
+        }
+
+
+        std::array<std::uint8_t, 32>
+        sha256_state::digest()
+            const noexcept
+        {
+            // Pad a copy, so the state can keep going.
+            sha256_state s = *this;
+            const std::uint64_t bits = total * 8;
+            const std::byte one{0x80};
+            s.update({ &one, 1 });
+            const std::byte zero{0};
+            while (s.buf_size != 56)
+                s.update({ &zero, 1 });
+            std::byte len[8];
+            for (int i = 0; i < 8; ++i)
+                len[i] = std::byte(bits >> (56 - 8 * i));
+            s.update(len);
+
+            std::array<std::uint8_t, 32> result;
+            for (int i = 0; i < 8; ++i)
+                for (int j = 0; j < 4; ++j)
+                    result[4 * i + j] = s.h[i] >> (24 - 8 * j);
+            return result;
+        }
+
+    } // namespace detail
+
+
+    std::string
+    pcm_digest::hex()
+        const
+    {
+        std::array<std::uint8_t, 8> bytes;
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = xxh64 >> (56 - 8 * i);
+        return to_hex(bytes);
+    }
+
+
+    std::string
+    pcm_digest::sha256_hex()
+        const
+    {
+        if (!sha256)
+            return {};
+        return to_hex(*sha256);
+    }
+
+
+    pcm_hasher::pcm_hasher(long rate,
+                           unsigned channels,
+                           bool with_sha256) :
+        channels{std::max(channels, 1u)}
+    {
+        if (with_sha256)
+            sha.emplace();
+        // Little-endian, so the hash is the same on every host.
+        std::byte header[8];
+        for (int i = 0; i < 4; ++i)
+            header[i] = std::byte(rate >> (8 * i));
+        for (int i = 0; i < 4; ++i)
+            header[4 + i] = std::byte(channels >> (8 * i));
+        hash(header);
+    }
+
+
+    void
+    pcm_hasher::hash(std::span<const std::byte> data)
+        noexcept
+    {
+        xxh.update(data);
+        if (sha)
+            sha->update(data);
+    }
+
+
+    void
+    pcm_hasher::update(std::span<const std::byte> samples)
+    {
+        samples = samples.first(samples.size() & ~std::size_t{1});
+        this->samples += samples.size() / 2 / channels;
+        if constexpr (std::endian::native == std::endian::big) {
+            // Hash little-endian samples, in chunks.
+            std::byte swapped[4096];
+            while (!samples.empty()) {
+                const std::size_t n = std::min(samples.size(), sizeof swapped);
+                for (std::size_t i = 0; i < n; i += 2) {
+                    swapped[i] = samples[i + 1];
+                    swapped[i + 1] = samples[i];
+                }
+                hash({ swapped, n });
+                samples = samples.subspan(n);
+            }
+        } else
+            hash(samples);
+    }
+
+
+    pcm_digest
+    pcm_hasher::digest()
+        const
+    {
+        pcm_digest result;
+        result.xxh64 = xxh.digest();
+        if (sha)
+            result.sha256 = sha->digest();
+        result.samples = samples;
+        return result;
+    }
+
+
+    void
+    configure_for_hash(handle& h)
+    {
+        h.format_none();
+        for (long rate : supported_rates())
+            h.set_format(rate, MPG123_MONO | MPG123_STEREO, MPG123_ENC_SIGNED_16);
+        h.add_flags(MPG123_GAPLESS);
+        h.remove_flags(MPG123_IGNORE_INFOFRAME | MPG123_FORCE_MONO | MPG123_FORCE_STEREO
+                       | MPG123_FORCE_8BIT | MPG123_FORCE_FLOAT);
+        h.set_rva(MPG123_RVA_OFF);
+    }
+
+
+    pcm_digest
+    hash_pcm(handle& h,
+             bool with_sha256)
+    {
+        std::optional<pcm_hasher> hasher;
+        for (;;) {
+            auto f = h.try_decode_frame();
+            if (!f) {
+                if (f.error().code == MPG123_NEW_FORMAT)
+                    continue;
+                if (f.error().code == MPG123_DONE)
+                    break;
+                throw f.error();
+            }
+            if (!hasher) {
+                const format fmt = h.get_format();
+                if (fmt.encoding != MPG123_ENC_SIGNED_16)
+                    throw std::invalid_argument{"PCM hashing needs signed 16-bit output"};
+                hasher.emplace(fmt.rate, fmt.channels, with_sha256);
+            }
+            hasher->update(f->samples);
+        }
+        if (!hasher)
+            hasher.emplace(0, 0, with_sha256);
+        return hasher->digest();
+    }
+
+
+    pcm_digest
+    hash_pcm(const path& filename,
+             bool with_sha256)
+    {
+        handle h;
+        configure_for_hash(h);
+        h.open(filename);
+        return hash_pcm(h, with_sha256);
+    }
+
+
+    std::vector<std::optional<pcm_digest>>
+    hash_files(std::span<const path> files,
+               const pcm_hash_options& opts)
+    {
+        unsigned threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+        threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(files.size(), 1));
+
+        std::vector<std::optional<pcm_digest>> result(files.size());
+        std::atomic_size_t next = 0;
+        auto work = [&]
+        {
+            for (std::size_t i; (i = next++) < files.size();) {
+                try {
+                    result[i] = hash_pcm(files[i], opts.sha256);
+                }
+                catch (std::exception&) {
+                    // Leave it empty.
+                }
+            }
+        };
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(work);
+        work();
+        workers.clear();
+        return result;
+    }
+
+} // namespace mpg123
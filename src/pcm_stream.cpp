@@ -0,0 +1,181 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+
+#include "mpg123xx/pcm_stream.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+using std::expected;
+using std::unexpected;
+
+
+namespace mpg123 {
+
+    output_buffer::output_buffer(std::size_t size) :
+        capacity{std::max(size, mpg123_safe_buffer())}
+    {
+        storage = std::make_unique_for_overwrite<std::byte[]>(capacity);
+    }
+
+
+    void
+    output_buffer::attach(handle& h)
+    {
+        auto result = try_attach(h);
+        if (!result)
+            throw result.error();
+    }
+
+
+    expected<void, error>
+    output_buffer::try_attach(handle& h)
+        noexcept
+    {
+        return h.try_replace_buffer(data());
+    }
+
+
+    std::span<std::byte>
+    output_buffer::data()
+        noexcept
+    {
+        return {storage.get(), capacity};
+    }
+
+
+    std::size_t
+    output_buffer::size()
+        const noexcept
+    {
+        return capacity;
+    }
+
+
+    pcm_stream::pcm_stream(handle& h) :
+        pcm_stream{h, options{}}
+    {}
+
+
+    pcm_stream::pcm_stream(handle& h,
+                           const options& opts) :
+        h{&h},
+        own_buf{std::in_place, opts.buffer_size},
+        buf{&*own_buf}
+    {
+        if (opts.forced)
+            h.force_format(*opts.forced);
+        buf->attach(h);
+    }
+
+
+    pcm_stream::pcm_stream(handle& h,
+                           output_buffer& buf) :
+        pcm_stream{h, buf, options{}}
+    {}
+
+
+    pcm_stream::pcm_stream(handle& h,
+                           output_buffer& buf,
+                           const options& opts) :
+        h{&h},
+        buf{&buf}
+    {
+        if (opts.forced)
+            h.force_format(*opts.forced);
+        buf.attach(h);
+    }
+
+
+    pcm_event
+    pcm_stream::next()
+    {
+        auto result = try_next();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<pcm_event, error>
+    pcm_stream::try_next()
+        noexcept
+    {
+        for (;;) {
+            auto f = h->try_decode_frame();
+            if (f) {
+                // Frames trimmed away by gapless decoding come out empty.
+                if (f->samples.empty())
+                    continue;
+                return pcm_event{
+                    .type = pcm_event::kind::samples,
+                    .fmt = current.value_or(format{}),
+                    .samples = f->samples
+                };
+            }
+
+            switch (f.error().code) {
+                case MPG123_NEW_FORMAT: {
+                    auto fmt = h->try_get_format();
+                    if (!fmt)
+                        return unexpected{fmt.error()};
+                    if (current == *fmt)
+                        continue;
+                    if (current)
+                        ++changes;
+                    current = *fmt;
+                    return pcm_event{
+                        .type = pcm_event::kind::new_format,
+                        .fmt = *fmt,
+                        .samples = {}
+                    };
+                }
+                case MPG123_NEED_MORE:
+                    return pcm_event{
+                        .type = pcm_event::kind::need_more,
+                        .fmt = current.value_or(format{}),
+                        .samples = {}
+                    };
+                case MPG123_DONE:
+                    return pcm_event{
+                        .type = pcm_event::kind::done,
+                        .fmt = current.value_or(format{}),
+                        .samples = {}
+                    };
+                default:
+                    return unexpected{f.error()};
+            }
+        }
+    }
+
+
+    const std::optional<format>&
+    pcm_stream::current_format()
+        const noexcept
+    {
+        return current;
+    }
+
+
+    std::uintmax_t
+    pcm_stream::format_changes()
+        const noexcept
+    {
+        return changes;
+    }
+
+
+    const output_buffer&
+    pcm_stream::buffer()
+        const noexcept
+    {
+        return *buf;
+    }
+
+} // namespace mpg123
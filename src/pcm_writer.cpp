@@ -0,0 +1,427 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mpg123xx/pcm_writer.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // Large enough for a WAVE_FORMAT_EXTENSIBLE header.
+        constexpr std::size_t max_wav_header_size = 68;
+
+
+        [[noreturn]]
+        void
+        throw_errno(int e,
+                    const char* what)
+        {
+            throw std::system_error{e, std::generic_category(), what};
+        }
+
+
+        unsigned
+        wav_format_tag(unsigned encoding)
+        {
+            switch (encoding) {
+                case MPG123_ENC_UNSIGNED_8:
+                case MPG123_ENC_SIGNED_16:
+                case MPG123_ENC_SIGNED_24:
+                case MPG123_ENC_SIGNED_32:
+                    return 1; // PCM
+                case MPG123_ENC_FLOAT_32:
+                case MPG123_ENC_FLOAT_64:
+                    return 3; // IEEE float
+                case MPG123_ENC_ALAW_8:
+                    return 6;
+                case MPG123_ENC_ULAW_8:
+                    return 7;
+                default:
+                    throw std::invalid_argument{"encoding can't be stored in a WAV file"};
+            }
+        }
+
+
+        // WAVE_FORMAT_EXTENSIBLE is needed for more than 16 bits or 2 channels.
+        bool
+        wav_extensible(const format& fmt)
+        {
+            return fmt.channels > 2 || sample_size(fmt.encoding) > 2;
+        }
+
+
+        std::size_t
+        wav_header_size(const format& fmt)
+        {
+            return wav_extensible(fmt) ? max_wav_header_size : 44;
+        }
+
+
+        std::byte*
+        put_le(std::byte* dst,
+               std::uint32_t value,
+               unsigned bytes)
+            noexcept
+        {
+            for (unsigned i = 0; i < bytes; ++i)
+                *dst++ = std::byte(value >> (8 * i));
+            return dst;
+        }
+
+
+        std::byte*
+        put_tag(std::byte* dst,
+                const char (&tag)[5])
+            noexcept
+        {
+            std::memcpy(dst, tag, 4);
+            return dst + 4;
+        }
+
+
+        void
+        make_wav_header(std::byte (&dst)[max_wav_header_size],
+                        const format& fmt,
+                        std::uint64_t data_size)
+        {
+            const std::uint32_t max = 0xffffffff;
+            const bool extensible = wav_extensible(fmt);
+            const unsigned header_size = wav_header_size(fmt);
+            const unsigned ssize = sample_size(fmt.encoding);
+            const unsigned tag = wav_format_tag(fmt.encoding);
+            const std::uint32_t data32 = std::min<std::uint64_t>(data_size,
+                                                                 max - (header_size - 8));
+            std::byte* p = dst;
+            p = put_tag(p, "RIFF");
+            p = put_le(p, data32 + header_size - 8, 4);
+            p = put_tag(p, "WAVE");
+            p = put_tag(p, "fmt ");
+            p = put_le(p, extensible ? 40 : 16, 4);
+            p = put_le(p, extensible ? 0xfffe : tag, 2);
+            p = put_le(p, fmt.channels, 2);
+            p = put_le(p, fmt.rate, 4);
+            p = put_le(p, fmt.rate * fmt.channels * ssize, 4);
+            p = put_le(p, fmt.channels * ssize, 2);
+            p = put_le(p, 8 * ssize, 2);
+            if (extensible) {
+                p = put_le(p, 22, 2); // extension size
+                p = put_le(p, 8 * ssize, 2); // valid bits
+                // Front center for mono, front left and right for stereo.
+                p = put_le(p, fmt.channels == 1 ? 0x4 : fmt.channels == 2 ? 0x3 : 0, 4);
+                // Sub-format GUID: the format tag, then the base GUID
+                // 00000000-0000-0010-8000-00AA00389B71.
+                constexpr unsigned char guid_tail[12] = {
+                    0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+                };
+                p = put_le(p, tag, 4);
+                std::memcpy(p, guid_tail, sizeof guid_tail);
+                p += sizeof guid_tail;
+            }
+            p = put_tag(p, "data");
+            put_le(p, data32, 4);
+        }
+
+    } // namespace
+
+
+    void
+    pcm_writer::aligned_delete::operator ()(std::byte* p)
+        const noexcept
+    {
+        ::operator delete[](p, std::align_val_t{alignment});
+    }
+
+
+    pcm_writer::pcm_writer(const path& filename,
+                           const format& fmt)
+    {
+        open(filename, fmt);
+    }
+
+
+    pcm_writer::pcm_writer(const path& filename,
+                           const format& fmt,
+                           const options& opts)
+    {
+        open(filename, fmt, opts);
+    }
+
+
+    pcm_writer::pcm_writer(pcm_writer&& other)
+        noexcept :
+        fd{std::exchange(other.fd, -1)},
+        fmt{other.fmt},
+        opts{other.opts},
+        buffer{std::move(other.buffer)},
+        fill{std::exchange(other.fill, 0)},
+        header_size{std::exchange(other.header_size, 0)},
+        data_size{std::exchange(other.data_size, 0)}
+    {}
+
+
+    pcm_writer&
+    pcm_writer::operator =(pcm_writer&& other)
+        noexcept
+    {
+        if (this != &other) {
+            try {
+                close();
+            }
+            catch (...) {}
+            fd = std::exchange(other.fd, -1);
+            fmt = other.fmt;
+            opts = other.opts;
+            buffer = std::move(other.buffer);
+            fill = std::exchange(other.fill, 0);
+            header_size = std::exchange(other.header_size, 0);
+            data_size = std::exchange(other.data_size, 0);
+        }
+        return *this;
+    }
+
+
+    pcm_writer::~pcm_writer()
+        noexcept
+    {
+        try {
+            close();
+        }
+        catch (...) {}
+    }
+
+
+    void
+    pcm_writer::open(const path& filename,
+                     const format& fmt)
+    {
+        open(filename, fmt, options{});
+    }
+
+
+    void
+    pcm_writer::open(const path& filename,
+                     const format& new_fmt,
+                     const options& new_opts)
+    {
+        if (!new_opts.buffer_size || new_opts.buffer_size % alignment)
+            throw std::invalid_argument{"buffer size must be a multiple of 4096"};
+        if (new_opts.type == container::wav)
+            wav_format_tag(new_fmt.encoding);
+
+        close();
+
+        // Allocate first, so a failure here doesn't leak the file descriptor.
+        if (!buffer || opts.buffer_size != new_opts.buffer_size) {
+            buffer.reset(new (std::align_val_t{alignment}) std::byte[new_opts.buffer_size]);
+            opts.buffer_size = new_opts.buffer_size;
+        }
+
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        if (new_opts.direct)
+            flags |= O_DIRECT;
+        int new_fd = ::open(filename.c_str(), flags, 0666);
+        if (new_fd < 0)
+            throw_errno(errno, "open()");
+
+        if (new_opts.preallocate) {
+            int e = ::posix_fallocate(new_fd, 0, new_opts.preallocate);
+            // Not every filesystem can preallocate; that's not fatal.
+            if (e && e != EOPNOTSUPP && e != EINVAL) {
+                ::close(new_fd);
+                throw_errno(e, "posix_fallocate()");
+            }
+        }
+
+        fd = new_fd;
+        fmt = new_fmt;
+        opts = new_opts;
+        data_size = 0;
+        fill = 0;
+        header_size = 0;
+        if (opts.type == container::wav) {
+            // Reserve room for the header; it gets patched on close().
+            fill = header_size = wav_header_size(fmt);
+            std::memset(buffer.get(), 0, header_size);
+        }
+    }
+
+
+    bool
+    pcm_writer::is_open()
+        const noexcept
+    {
+        return fd >= 0;
+    }
+
+
+    void
+    pcm_writer::close()
+    {
+        if (fd < 0)
+            return;
+
+        try {
+            const std::uint64_t flushed = header_size + data_size - fill;
+            if (opts.direct) {
+                // The tail and the header are not aligned, so O_DIRECT must go.
+                int flags = ::fcntl(fd, F_GETFL);
+                if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0)
+                    throw_errno(errno, "fcntl()");
+            }
+            if (fill)
+                write_fully(buffer.get(), fill, flushed);
+            fill = 0;
+
+            if (opts.preallocate)
+                if (::ftruncate(fd, header_size + data_size) < 0)
+                    throw_errno(errno, "ftruncate()");
+
+            if (opts.type == container::wav) {
+                std::byte header[max_wav_header_size];
+                make_wav_header(header, fmt, data_size);
+                write_fully(header, header_size, 0);
+            }
+        }
+        catch (...) {
+            reset();
+            throw;
+        }
+
+        int e = ::close(std::exchange(fd, -1));
+        reset();
+        if (e < 0)
+            throw_errno(errno, "close()");
+    }
+
+
+    void
+    pcm_writer::write(const void* buf,
+                      std::size_t size)
+    {
+        if (!is_open())
+            throw std::logic_error{"pcm_writer: no file open"};
+        auto src = static_cast<const std::byte*>(buf);
+        while (size) {
+            std::size_t n = std::min(size, opts.buffer_size - fill);
+            std::memcpy(buffer.get() + fill, src, n);
+            fill += n;
+            data_size += n;
+            src += n;
+            size -= n;
+            if (fill == opts.buffer_size)
+                flush_full();
+        }
+    }
+
+
+    void
+    pcm_writer::write(const frame& f)
+    {
+        write(f.samples);
+    }
+
+
+    std::uint64_t
+    pcm_writer::write_all(handle& h)
+    {
+        if (!is_open())
+            throw std::logic_error{"pcm_writer: no file open"};
+        std::uint64_t total = 0;
+        for (;;) {
+            auto result = h.try_read(buffer.get() + fill, opts.buffer_size - fill);
+            if (!result) {
+                if (result.error().code == MPG123_DONE)
+                    break;
+                if (result.error().code == MPG123_NEW_FORMAT) {
+                    auto new_fmt = h.get_format();
+                    if (new_fmt.rate == fmt.rate
+                        && new_fmt.channels == fmt.channels
+                        && new_fmt.encoding == fmt.encoding)
+                        continue;
+                }
+                throw result.error();
+            }
+            fill += *result;
+            data_size += *result;
+            total += *result;
+            if (fill == opts.buffer_size)
+                flush_full();
+        }
+        return total;
+    }
+
+
+    std::uint64_t
+    pcm_writer::size()
+        const noexcept
+    {
+        return data_size;
+    }
+
+
+    const format&
+    pcm_writer::get_format()
+        const noexcept
+    {
+        return fmt;
+    }
+
+
+    void
+    pcm_writer::flush_full()
+    {
+        const std::uint64_t offset = header_size + data_size - fill;
+        write_fully(buffer.get(), fill, offset);
+        fill = 0;
+    }
+
+
+    void
+    pcm_writer::write_fully(const std::byte* data,
+                            std::size_t size,
+                            std::uint64_t offset)
+    {
+        while (size) {
+            ssize_t n = ::pwrite(fd, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno(errno, "pwrite()");
+            }
+            data += n;
+            size -= n;
+            offset += n;
+        }
+    }
+
+
+    void
+    pcm_writer::reset()
+        noexcept
+    {
+        if (fd >= 0)
+            ::close(std::exchange(fd, -1));
+        fill = 0;
+        header_size = 0;
+        data_size = 0;
+    }
+
+} // namespace mpg123
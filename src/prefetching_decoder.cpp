@@ -0,0 +1,203 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "mpg123xx/prefetching_decoder.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        std::size_t
+        lookahead_for(handle& h,
+                      const prefetching_decoder::options& opts)
+        {
+            std::size_t frames = opts.lookahead_frames;
+            if (opts.lookahead_ms) {
+                double tpf = h.tpf();
+                if (tpf > 0)
+                    frames = std::ceil(opts.lookahead_ms / 1000.0 / tpf);
+            }
+            return std::max<std::size_t>(frames, 1);
+        }
+
+    } // namespace
+
+
+    prefetching_decoder::prefetching_decoder(handle&& source) :
+        prefetching_decoder{std::move(source), options{}}
+    {}
+
+
+    prefetching_decoder::prefetching_decoder(handle&& source,
+                                             const options& opts) :
+        h{std::move(source)},
+        fmt{h.get_format()},
+        capacity{lookahead_for(h, opts)},
+        // Room for the queue, the frame being decoded and the one being used.
+        pool{h.outblock(), capacity + 2},
+        ring(capacity)
+    {
+        worker = std::jthread{[this] { work(); }};
+    }
+
+
+    prefetching_decoder::~prefetching_decoder()
+        noexcept
+    {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+        // The frames must go back to the pool before it's destroyed.
+        ring.clear();
+    }
+
+
+    std::optional<frame_buffer>
+    prefetching_decoder::try_pop()
+    {
+        std::optional<frame_buffer> result;
+        {
+            std::lock_guard lock{mutex};
+            if (!count)
+                return {};
+            result = std::move(ring[head]);
+            head = (head + 1) % capacity;
+            --count;
+        }
+        cv.notify_all();
+        return result;
+    }
+
+
+    void
+    prefetching_decoder::seek(std::intmax_t sample)
+    {
+        {
+            std::lock_guard lock{mutex};
+            for (; count; --count, head = (head + 1) % capacity)
+                ring[head].reset();
+            pending_seek = sample;
+            ++generation;
+            at_end = false;
+            failure.reset();
+        }
+        cv.notify_all();
+    }
+
+
+    const format&
+    prefetching_decoder::get_format()
+        const noexcept
+    {
+        return fmt;
+    }
+
+
+    std::size_t
+    prefetching_decoder::lookahead()
+        const noexcept
+    {
+        return capacity;
+    }
+
+
+    std::size_t
+    prefetching_decoder::buffered()
+        const
+    {
+        std::lock_guard lock{mutex};
+        return count;
+    }
+
+
+    bool
+    prefetching_decoder::finished()
+        const
+    {
+        std::lock_guard lock{mutex};
+        return at_end && !count && !pending_seek;
+    }
+
+
+    std::optional<error>
+    prefetching_decoder::get_error()
+        const
+    {
+        std::lock_guard lock{mutex};
+        return failure;
+    }
+
+
+    void
+    prefetching_decoder::work()
+    {
+        std::unique_lock lock{mutex};
+        for (;;) {
+            cv.wait(lock,
+                    [this]
+                    {
+                        return stopping || pending_seek || (!at_end && count < capacity);
+                    });
+            if (stopping)
+                return;
+
+            // Only this thread touches the handle; the lock is released while it
+            // works, so try_pop() never waits for it.
+            const unsigned gen = generation;
+
+            if (pending_seek) {
+                auto pos = *std::exchange(pending_seek, std::nullopt);
+                lock.unlock();
+                auto r = h.try_seek(pos);
+                lock.lock();
+                if (!r && gen == generation) {
+                    at_end = true;
+                    failure = r.error();
+                }
+                continue;
+            }
+
+            lock.unlock();
+            auto f = pool.try_decode(h);
+            lock.lock();
+            if (gen != generation)
+                continue; // decoded from before a seek
+            if (!f) {
+                switch (f.error().code) {
+                    case MPG123_NEW_FORMAT:
+                        // Frames don't carry a format, so a change can't be
+                        // passed on; end the stream instead.
+                        if (auto nf = h.try_get_format(); !nf || *nf != fmt) {
+                            at_end = true;
+                            failure = nf ? error{MPG123_BAD_OUTFORMAT} : nf.error();
+                        }
+                        break;
+                    case MPG123_DONE:
+                        at_end = true;
+                        break;
+                    default:
+                        at_end = true;
+                        failure = f.error();
+                }
+                continue;
+            }
+            if (f->samples().empty())
+                continue;
+            ring[(head + count) % capacity] = std::move(*f);
+            ++count;
+        }
+    }
+
+} // namespace mpg123
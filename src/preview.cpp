@@ -0,0 +1,154 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "mpg123xx/preview.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+using std::expected;
+using std::unexpected;
+
+
+namespace mpg123 {
+
+    namespace {
+
+        using clock = std::chrono::steady_clock;
+
+
+        double
+        seconds_since(clock::time_point start)
+        {
+            return std::chrono::duration<double>(clock::now() - start).count();
+        }
+
+    } // namespace
+
+
+    void
+    configure_for_preview(handle& h,
+                          const preview_options& opts)
+    {
+        h.set_down_sample(opts.down_sample);
+        h.remove_flags(MPG123_FORCE_MONO | MPG123_FORCE_STEREO
+                       | MPG123_FORCE_8BIT | MPG123_FORCE_FLOAT);
+        unsigned flags = opts.use_float ? MPG123_FORCE_FLOAT : MPG123_FORCE_8BIT;
+        if (opts.mono)
+            flags |= MPG123_MONO_MIX;
+        h.add_flags(flags);
+    }
+
+
+    preview_decoder::preview_decoder(handle& h,
+                                     const preview_options& opts) :
+        h{&h},
+        step{std::max(opts.frame_step, 1u)},
+        // Warming up with every frame in between is just decoding everything.
+        warm_up{std::min(opts.warm_up, step - 1)}
+    {}
+
+
+    frame
+    preview_decoder::next()
+    {
+        auto result = try_next();
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    expected<frame, error>
+    preview_decoder::try_next()
+        noexcept
+    {
+        for (;;) {
+            // Format changes need no handling here; get_format() has the new one.
+            if (auto r = h->try_framebyframe_next(); !r)
+                return unexpected{r.error()};
+            // Frame 0 of each group is kept, the last warm_up of the group are
+            // decoded to prime the synthesis for the next group's frame 0.
+            const auto phase = seen++ % step;
+            const bool keep = phase == 0;
+            if (!keep && phase < step - warm_up)
+                continue;
+            auto f = h->try_framebyframe_decode();
+            if (!f)
+                return unexpected{f.error()};
+            ++decoded;
+            if (keep)
+                return f;
+        }
+    }
+
+
+    std::uintmax_t
+    preview_decoder::frames_seen()
+        const noexcept
+    {
+        return seen;
+    }
+
+
+    std::uintmax_t
+    preview_decoder::frames_decoded()
+        const noexcept
+    {
+        return decoded;
+    }
+
+
+    preview_report
+    measure_preview(const path& filename,
+                    const preview_options& opts)
+    {
+        preview_report report;
+
+        {
+            auto start = clock::now();
+            handle h;
+            h.open(filename);
+            for (;;) {
+                auto f = h.try_decode_frame();
+                if (!f) {
+                    if (f.error().code == MPG123_NEW_FORMAT)
+                        continue;
+                    if (f.error().code == MPG123_DONE)
+                        break;
+                    throw f.error();
+                }
+            }
+            report.full_seconds = seconds_since(start);
+        }
+
+        {
+            auto start = clock::now();
+            handle h;
+            configure_for_preview(h, opts);
+            h.open(filename);
+            preview_decoder dec{h, opts};
+            for (;;) {
+                auto f = dec.try_next();
+                if (!f) {
+                    if (f.error().code == MPG123_DONE)
+                        break;
+                    throw f.error();
+                }
+            }
+            report.preview_seconds = seconds_since(start);
+            report.frames = dec.frames_seen();
+            report.frames_decoded = dec.frames_decoded();
+        }
+
+        return report;
+    }
+
+} // namespace mpg123
@@ -0,0 +1,857 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpg123xx/shm_pcm.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace detail {
+
+        // Format changes kept in the header; a reader more than this many changes
+        // behind the writer gets the oldest one.
+        constexpr unsigned max_formats = 16;
+
+
+        // Entries get reused while readers may be reading them, so each one is a
+        // seqlock: seq is odd while the writer rewrites it.
+        struct shm_format_entry {
+            std::atomic<std::uint32_t> seq;
+            std::atomic<std::uint64_t> number; // index in the list of format changes
+            std::atomic<std::uint64_t> pos;    // write position where this format starts
+            std::atomic<std::int64_t> rate;
+            std::atomic<std::uint32_t> channels;
+            std::atomic<std::uint32_t> encoding;
+        };
+
+
+        struct shm_reader_slot {
+            alignas(64) std::atomic<std::uint64_t> pos;
+            std::atomic<std::uint32_t> state;
+            std::atomic<std::int32_t> pid;
+        };
+
+
+        // Fixed part, also read with pread() before mapping.
+        struct shm_ring_info {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t max_readers;
+            std::uint64_t capacity;
+            std::uint64_t data_offset;
+            std::uint32_t lossy;
+        };
+
+
+        struct shm_ring_header {
+
+            shm_ring_info info;
+
+            alignas(64) std::atomic<std::uint64_t> write_pos;
+            std::atomic<std::uint32_t> data_seq;  // futex: bumped on commit and close
+            std::atomic<std::uint32_t> readers_waiting;
+            std::atomic<std::uint32_t> closed;
+
+            alignas(64) std::atomic<std::uint32_t> space_seq; // futex: bumped on consume
+            std::atomic<std::uint32_t> writer_waiting;
+
+            alignas(64) std::atomic<std::uint64_t> format_count;
+            shm_format_entry formats[max_formats];
+
+            // Followed by info.max_readers slots, then the data at info.data_offset.
+
+            shm_reader_slot*
+            slots()
+                noexcept
+            {
+                return reinterpret_cast<shm_reader_slot*>(this + 1);
+            }
+
+        };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+        static_assert(std::atomic<std::int64_t>::is_always_lock_free);
+        static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+        static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+
+    } // namespace detail
+
+
+    namespace {
+
+        using detail::shm_ring_header;
+        using detail::shm_reader_slot;
+
+
+        constexpr char ring_magic[8] = {'M', 'P', 'G', '1', '2', '3', 'S', 'R'};
+        constexpr std::uint32_t ring_version = 1;
+
+
+        // A slot belongs to the process whose pid is in it; the writer only waits
+        // for it once it's active.
+        enum : std::uint32_t {
+            slot_free,
+            slot_active,
+        };
+
+
+        std::size_t
+        page_size()
+            noexcept
+        {
+            static const std::size_t size = ::sysconf(_SC_PAGESIZE);
+            return size;
+        }
+
+
+        std::size_t
+        round_up(std::size_t n,
+                 std::size_t m)
+            noexcept
+        {
+            return (n + m - 1) / m * m;
+        }
+
+
+        std::size_t
+        header_bytes(unsigned max_readers)
+            noexcept
+        {
+            return round_up(sizeof(shm_ring_header) + max_readers * sizeof(shm_reader_slot),
+                            page_size());
+        }
+
+
+        // Most a lossy writer hands out at once. It writes over the oldest data, so
+        // keeping the rest untouched lets readers tell what's still intact.
+        std::size_t
+        lossy_span(std::size_t capacity)
+            noexcept
+        {
+            return capacity / 2;
+        }
+
+
+        // How far behind the write position a reader's data is still intact.
+        std::uint64_t
+        max_lag(const detail::shm_ring_mapping& ring)
+            noexcept
+        {
+            if (ring.header->info.lossy)
+                return ring.capacity - lossy_span(ring.capacity);
+            return ring.capacity;
+        }
+
+
+        struct format_snapshot {
+            std::uint64_t pos;
+            format fmt;
+        };
+
+
+        // Read format change number i; false if the writer is rewriting its entry,
+        // or already reused it for a later change.
+        bool
+        read_format(const shm_ring_header& h,
+                    std::uint64_t i,
+                    format_snapshot& out)
+            noexcept
+        {
+            const auto& e = h.formats[i % detail::max_formats];
+            const auto seq = e.seq.load(std::memory_order_acquire);
+            if (seq & 1)
+                return false;
+            const auto number = e.number.load(std::memory_order_relaxed);
+            out.pos = e.pos.load(std::memory_order_relaxed);
+            out.fmt = format{
+                .rate = static_cast<long>(e.rate.load(std::memory_order_relaxed)),
+                .channels = e.channels.load(std::memory_order_relaxed),
+                .encoding = e.encoding.load(std::memory_order_relaxed)
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return e.seq.load(std::memory_order_relaxed) == seq && number == i;
+        }
+
+
+        // Free the slots of readers that died without detaching, including the ones
+        // that died while attaching. Returns how many were freed.
+        unsigned
+        free_dead_slots(shm_ring_header& h)
+            noexcept
+        {
+            unsigned freed = 0;
+            auto* slots = h.slots();
+            for (unsigned i = 0; i < h.info.max_readers; ++i) {
+                auto pid = slots[i].pid.load();
+                if (pid <= 0 || ::kill(pid, 0) == 0 || errno != ESRCH)
+                    continue;
+                // Take the slot over first: the pid may be stale, and the slot
+                // already claimed again by a live reader.
+                if (!slots[i].pid.compare_exchange_strong(pid, -1))
+                    continue;
+                slots[i].state.store(slot_free);
+                slots[i].pid.store(0);
+                ++freed;
+            }
+            return freed;
+        }
+
+
+        // Returns true on timeout. The futexes are shared, so no FUTEX_PRIVATE_FLAG.
+        bool
+        futex_wait(std::atomic<std::uint32_t>& word,
+                   std::uint32_t old,
+                   std::chrono::nanoseconds timeout)
+            noexcept
+        {
+            using namespace std::chrono;
+            auto secs = duration_cast<seconds>(timeout);
+            ::timespec ts{
+                .tv_sec = static_cast<::time_t>(secs.count()),
+                .tv_nsec = static_cast<long>((timeout - secs).count())
+            };
+            long e = ::syscall(SYS_futex, &word, FUTEX_WAIT, old, &ts, nullptr, 0);
+            return e < 0 && errno == ETIMEDOUT;
+        }
+
+
+        void
+        futex_wake(std::atomic<std::uint32_t>& word)
+            noexcept
+        {
+            ::syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+    } // namespace
+
+
+    detail::shm_ring_mapping::shm_ring_mapping(int fd,
+                                               bool writable) :
+        fd{fd}
+    {
+        try {
+            struct ::stat st;
+            if (::fstat(fd, &st) < 0)
+                throw std::system_error{errno, std::generic_category(), "fstat()"};
+            const std::uint64_t file_size = st.st_size;
+
+            shm_ring_info info;
+            if (file_size < sizeof(shm_ring_header)
+                || ::pread(fd, &info, sizeof info, 0) != sizeof info)
+                throw std::runtime_error{"shm_pcm: not a PCM ring"};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (std::memcmp(info.magic, ring_magic, sizeof ring_magic)
+                || info.version != ring_version
+                || !info.capacity
+                || info.capacity % page_size()
+                || info.data_offset != header_bytes(info.max_readers)
+                || info.data_offset + info.capacity != file_size)
+                throw std::runtime_error{"shm_pcm: not a PCM ring, or not initialized yet"};
+
+            void* addr = ::mmap(nullptr, info.data_offset,
+                                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+                throw std::system_error{errno, std::generic_category(), "mmap()"};
+            header = static_cast<shm_ring_header*>(addr);
+            header_size = info.data_offset;
+
+            // Reserve twice the capacity, then map the data over both halves.
+            addr = ::mmap(nullptr, 2 * info.capacity,
+                          PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr == MAP_FAILED)
+                throw std::system_error{errno, std::generic_category(), "mmap()"};
+            data = static_cast<std::byte*>(addr);
+            capacity = info.capacity;
+            const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            for (std::byte* half : {data, data + capacity})
+                if (::mmap(half, capacity, prot, MAP_SHARED | MAP_FIXED,
+                           fd, info.data_offset) == MAP_FAILED)
+                    throw std::system_error{errno, std::generic_category(), "mmap()"};
+        }
+        catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+
+    detail::shm_ring_mapping::shm_ring_mapping(shm_ring_mapping&& other)
+        noexcept :
+        fd{std::exchange(other.fd, -1)},
+        header{std::exchange(other.header, nullptr)},
+        header_size{std::exchange(other.header_size, 0)},
+        data{std::exchange(other.data, nullptr)},
+        capacity{std::exchange(other.capacity, 0)}
+    {}
+
+
+    detail::shm_ring_mapping&
+    detail::shm_ring_mapping::operator =(shm_ring_mapping&& other)
+        noexcept
+    {
+        if (this != &other) {
+            unmap();
+            fd = std::exchange(other.fd, -1);
+            header = std::exchange(other.header, nullptr);
+            header_size = std::exchange(other.header_size, 0);
+            data = std::exchange(other.data, nullptr);
+            capacity = std::exchange(other.capacity, 0);
+        }
+        return *this;
+    }
+
+
+    detail::shm_ring_mapping::~shm_ring_mapping()
+        noexcept
+    {
+        unmap();
+    }
+
+
+    void
+    detail::shm_ring_mapping::unmap()
+        noexcept
+    {
+        if (data)
+            ::munmap(data, 2 * capacity);
+        if (header)
+            ::munmap(header, header_size);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+        header = nullptr;
+        header_size = 0;
+        data = nullptr;
+        capacity = 0;
+    }
+
+
+    shm_pcm_writer::shm_pcm_writer(int fd,
+                                   const options& opts,
+                                   std::string name) :
+        name{std::move(name)}
+    {
+        const unsigned max_readers = std::max(opts.max_readers, 1u);
+        const std::size_t capacity = round_up(std::max<std::size_t>(opts.capacity, 1),
+                                              page_size());
+        const std::size_t header_size = header_bytes(max_readers);
+
+        if (::ftruncate(fd, header_size + capacity) < 0) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error{e, std::generic_category(), "ftruncate()"};
+        }
+        void* addr = ::mmap(nullptr, header_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error{e, std::generic_category(), "mmap()"};
+        }
+        // The new segment is zero-filled, which is also what the atomics start as.
+        auto* header = std::construct_at(static_cast<shm_ring_header*>(addr));
+        for (unsigned i = 0; i < max_readers; ++i)
+            std::construct_at(header->slots() + i);
+        header->info.version = ring_version;
+        header->info.max_readers = max_readers;
+        header->info.capacity = capacity;
+        header->info.data_offset = header_size;
+        header->info.lossy = opts.lossy;
+        // Readers only accept the segment once the magic is there.
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->info.magic, ring_magic, sizeof ring_magic);
+        ::munmap(addr, header_size);
+
+        ring = detail::shm_ring_mapping{fd, true};
+    }
+
+
+    shm_pcm_writer
+    shm_pcm_writer::create(const std::string& name,
+                           const options& opts)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), "shm_open()"};
+        try {
+            return shm_pcm_writer{fd, opts, name};
+        }
+        catch (...) {
+            ::shm_unlink(name.c_str());
+            throw;
+        }
+    }
+
+
+    shm_pcm_writer
+    shm_pcm_writer::create_anonymous(const options& opts)
+    {
+        int fd = ::memfd_create("mpg123xx-pcm", MFD_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), "memfd_create()"};
+        return shm_pcm_writer{fd, opts, {}};
+    }
+
+
+    shm_pcm_writer::shm_pcm_writer(shm_pcm_writer&& other)
+        noexcept :
+        ring{std::move(other.ring)},
+        name{std::exchange(other.name, {})}
+    {}
+
+
+    shm_pcm_writer&
+    shm_pcm_writer::operator =(shm_pcm_writer&& other)
+        noexcept
+    {
+        if (this != &other) {
+            close();
+            if (!name.empty())
+                ::shm_unlink(name.c_str());
+            ring = std::move(other.ring);
+            name = std::exchange(other.name, {});
+        }
+        return *this;
+    }
+
+
+    shm_pcm_writer::~shm_pcm_writer()
+        noexcept
+    {
+        close();
+        if (!name.empty())
+            ::shm_unlink(name.c_str());
+    }
+
+
+    void
+    shm_pcm_writer::set_format(const format& fmt)
+    {
+        auto* h = ring.header;
+        if (!h)
+            throw std::logic_error{"shm_pcm_writer: no ring"};
+        const auto count = h->format_count.load(std::memory_order_relaxed);
+        if (count) {
+            // Only this process writes the entries, so no need for the seqlock.
+            const auto& last = h->formats[(count - 1) % detail::max_formats];
+            if (last.rate.load(std::memory_order_relaxed) == fmt.rate
+                && last.channels.load(std::memory_order_relaxed) == fmt.channels
+                && last.encoding.load(std::memory_order_relaxed) == fmt.encoding)
+                return;
+        }
+        auto& e = h->formats[count % detail::max_formats];
+        const auto seq = e.seq.load(std::memory_order_relaxed);
+        e.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.number.store(count, std::memory_order_relaxed);
+        e.pos.store(h->write_pos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        e.rate.store(fmt.rate, std::memory_order_relaxed);
+        e.channels.store(fmt.channels, std::memory_order_relaxed);
+        e.encoding.store(fmt.encoding, std::memory_order_relaxed);
+        e.seq.store(seq + 2, std::memory_order_release);
+        h->format_count.store(count + 1, std::memory_order_release);
+    }
+
+
+    std::size_t
+    shm_pcm_writer::free_space()
+        const noexcept
+    {
+        auto* h = ring.header;
+        if (h->info.lossy)
+            return lossy_span(ring.capacity);
+        const auto wp = h->write_pos.load(std::memory_order_relaxed);
+        std::uint64_t used = 0;
+        auto* slots = h->slots();
+        for (unsigned i = 0; i < h->info.max_readers; ++i)
+            if (slots[i].state.load() == slot_active)
+                used = std::max(used, wp - slots[i].pos.load(std::memory_order_acquire));
+        // A reader attaching while the writer lapped it may look further behind.
+        return ring.capacity - std::min<std::uint64_t>(used, ring.capacity);
+    }
+
+
+    std::span<std::byte>
+    shm_pcm_writer::writable()
+        noexcept
+    {
+        if (!ring.header)
+            return {};
+        const auto wp = ring.header->write_pos.load(std::memory_order_relaxed);
+        return {ring.data + wp % ring.capacity, free_space()};
+    }
+
+
+    std::span<std::byte>
+    shm_pcm_writer::wait_writable(std::size_t min_size)
+    {
+        auto* h = ring.header;
+        if (!h)
+            throw std::logic_error{"shm_pcm_writer: no ring"};
+        min_size = std::clamp<std::size_t>(min_size, 1,
+                                           h->info.lossy
+                                           ? lossy_span(ring.capacity)
+                                           : ring.capacity);
+        for (;;) {
+            const auto old = h->space_seq.load();
+            if (auto s = writable(); s.size() >= min_size)
+                return s;
+            h->writer_waiting.store(1);
+            if (auto s = writable(); s.size() >= min_size)
+                return s;
+            // Wake up now and then to check for readers that died attached.
+            if (futex_wait(h->space_seq, old, std::chrono::milliseconds{100}))
+                drop_dead_readers();
+        }
+    }
+
+
+    void
+    shm_pcm_writer::drop_dead_readers()
+        noexcept
+    {
+        free_dead_slots(*ring.header);
+    }
+
+
+    void
+    shm_pcm_writer::commit(std::size_t n)
+    {
+        auto* h = ring.header;
+        if (!h)
+            throw std::logic_error{"shm_pcm_writer: no ring"};
+        if (!h->format_count.load(std::memory_order_relaxed))
+            throw std::logic_error{"shm_pcm_writer: set_format() must come before any data"};
+        const auto wp = h->write_pos.load(std::memory_order_relaxed);
+        h->write_pos.store(wp + n, std::memory_order_release);
+        h->data_seq.fetch_add(1);
+        if (h->readers_waiting.load())
+            futex_wake(h->data_seq);
+    }
+
+
+    void
+    shm_pcm_writer::write(std::span<const std::byte> data)
+    {
+        while (!data.empty()) {
+            auto buf = wait_writable(data.size());
+            const std::size_t n = std::min(buf.size(), data.size());
+            std::memcpy(buf.data(), data.data(), n);
+            commit(n);
+            data = data.subspan(n);
+        }
+    }
+
+
+    std::uint64_t
+    shm_pcm_writer::write_all(handle& h)
+    {
+        const std::size_t block = std::min<std::size_t>(capacity() / 4, 64 * 1024);
+        std::uint64_t total = 0;
+        for (;;) {
+            auto buf = wait_writable(block);
+            auto result = h.try_read(buf.data(), buf.size());
+            if (result) {
+                commit(*result);
+                total += *result;
+                continue;
+            }
+            switch (result.error().code) {
+                case MPG123_NEW_FORMAT:
+                    set_format(h.get_format());
+                    break;
+                case MPG123_NEED_MORE:
+                    return total;
+                case MPG123_DONE:
+                    close();
+                    return total;
+                default:
+                    throw result.error();
+            }
+        }
+    }
+
+
+    void
+    shm_pcm_writer::close()
+        noexcept
+    {
+        auto* h = ring.header;
+        if (!h)
+            return;
+        h->closed.store(1, std::memory_order_release);
+        h->data_seq.fetch_add(1);
+        futex_wake(h->data_seq);
+    }
+
+
+    int
+    shm_pcm_writer::fd()
+        const noexcept
+    {
+        return ring.fd;
+    }
+
+
+    std::size_t
+    shm_pcm_writer::capacity()
+        const noexcept
+    {
+        return ring.capacity;
+    }
+
+
+    unsigned
+    shm_pcm_writer::num_readers()
+        const noexcept
+    {
+        if (!ring.header)
+            return 0;
+        auto* slots = ring.header->slots();
+        unsigned count = 0;
+        for (unsigned i = 0; i < ring.header->info.max_readers; ++i)
+            count += slots[i].state.load() == slot_active;
+        return count;
+    }
+
+
+    shm_pcm_reader::shm_pcm_reader(const std::string& name)
+    {
+        // Read-write: the cursors and futexes live in the header.
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), "shm_open()"};
+        ring = detail::shm_ring_mapping{fd, false};
+        attach();
+    }
+
+
+    shm_pcm_reader::shm_pcm_reader(int fd)
+    {
+        int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (copy < 0)
+            throw std::system_error{errno, std::generic_category(), "fcntl()"};
+        ring = detail::shm_ring_mapping{copy, false};
+        attach();
+    }
+
+
+    shm_pcm_reader::shm_pcm_reader(shm_pcm_reader&& other)
+        noexcept :
+        ring{std::move(other.ring)},
+        slot{other.slot},
+        pos{other.pos},
+        lost{other.lost},
+        fmt{other.fmt}
+    {}
+
+
+    shm_pcm_reader&
+    shm_pcm_reader::operator =(shm_pcm_reader&& other)
+        noexcept
+    {
+        if (this != &other) {
+            detach();
+            ring = std::move(other.ring);
+            slot = other.slot;
+            pos = other.pos;
+            lost = other.lost;
+            fmt = other.fmt;
+        }
+        return *this;
+    }
+
+
+    shm_pcm_reader::~shm_pcm_reader()
+        noexcept
+    {
+        detach();
+    }
+
+
+    void
+    shm_pcm_reader::attach()
+    {
+        auto* h = ring.header;
+        auto* slots = h->slots();
+        auto claim = [&]
+        {
+            for (unsigned i = 0; i < h->info.max_readers; ++i) {
+                // Claim the slot with our pid, so it can be freed if we die before
+                // it's active.
+                std::int32_t expected = 0;
+                if (!slots[i].pid.compare_exchange_strong(expected, ::getpid()))
+                    continue;
+                // Start live, at the writer's position.
+                pos = h->write_pos.load(std::memory_order_acquire);
+                slots[i].pos.store(pos);
+                slots[i].state.store(slot_active);
+                slot = i;
+                return true;
+            }
+            return false;
+        };
+        // Slots of dead readers are otherwise only freed while the writer waits for
+        // them.
+        if (claim() || (free_dead_slots(*h) && claim()))
+            return;
+        throw std::runtime_error{"shm_pcm_reader: too many readers"};
+    }
+
+
+    void
+    shm_pcm_reader::detach()
+        noexcept
+    {
+        auto* h = ring.header;
+        if (!h)
+            return;
+        auto& s = h->slots()[slot];
+        s.state.store(slot_free);
+        s.pid.store(0);
+        h->space_seq.fetch_add(1);
+        if (h->writer_waiting.exchange(0))
+            futex_wake(h->space_seq);
+    }
+
+
+    std::span<const std::byte>
+    shm_pcm_reader::readable()
+        noexcept
+    {
+        auto* h = ring.header;
+        if (!h)
+            return {};
+        const auto wp = h->write_pos.load(std::memory_order_acquire);
+        if (wp - pos > max_lag(ring)) {
+            lost += wp - pos;
+            pos = wp;
+            h->slots()[slot].pos.store(pos, std::memory_order_release);
+        }
+
+        // Find the latest format starting at or before pos; the next one bounds
+        // the span. Start over if the writer reuses an entry meanwhile.
+        std::uint64_t end = wp;
+        for (bool consistent = false; !consistent;) {
+            const auto count = h->format_count.load(std::memory_order_acquire);
+            if (!count)
+                break;
+            const auto oldest = count > detail::max_formats ? count - detail::max_formats : 0;
+            end = wp;
+            format_snapshot e;
+            for (auto i = count - 1; (consistent = read_format(*h, i, e)); --i) {
+                if (i == oldest || e.pos <= pos)
+                    break;
+                end = std::min(end, e.pos);
+            }
+            if (consistent)
+                fmt = e.fmt;
+        }
+        return {ring.data + pos % ring.capacity, end - pos};
+    }
+
+
+    std::span<const std::byte>
+    shm_pcm_reader::wait_readable(std::chrono::milliseconds timeout)
+    {
+        auto* h = ring.header;
+        if (!h)
+            throw std::logic_error{"shm_pcm_reader: no ring"};
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            if (auto s = readable(); !s.empty() || eof())
+                return s;
+            const auto left = deadline - std::chrono::steady_clock::now();
+            if (left <= left.zero())
+                return {};
+            h->readers_waiting.fetch_add(1);
+            const auto old = h->data_seq.load();
+            // Data may have been committed before readers_waiting went up.
+            auto s = readable();
+            if (s.empty() && !eof())
+                futex_wait(h->data_seq, old, left);
+            h->readers_waiting.fetch_sub(1);
+            if (!s.empty())
+                return s;
+        }
+    }
+
+
+    bool
+    shm_pcm_reader::consume(std::size_t n)
+        noexcept
+    {
+        auto* h = ring.header;
+        if (!h)
+            return false;
+        // Check before moving the cursor, which lets the writer reuse the space. A
+        // lossy writer may be filling up to lossy_span() bytes past write_pos.
+        const bool intact = h->write_pos.load(std::memory_order_acquire) - pos <= max_lag(ring);
+        pos += n;
+        h->slots()[slot].pos.store(pos, std::memory_order_release);
+        h->space_seq.fetch_add(1);
+        if (h->writer_waiting.exchange(0))
+            futex_wake(h->space_seq);
+        return intact;
+    }
+
+
+    format
+    shm_pcm_reader::get_format()
+        const noexcept
+    {
+        return fmt;
+    }
+
+
+    bool
+    shm_pcm_reader::eof()
+        const noexcept
+    {
+        auto* h = ring.header;
+        return h
+            && h->closed.load(std::memory_order_acquire)
+            && pos == h->write_pos.load(std::memory_order_acquire);
+    }
+
+
+    std::uint64_t
+    shm_pcm_reader::position()
+        const noexcept
+    {
+        return pos;
+    }
+
+
+    std::uint64_t
+    shm_pcm_reader::dropped()
+        const noexcept
+    {
+        return lost;
+    }
+
+} // namespace mpg123
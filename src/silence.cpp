@@ -0,0 +1,449 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "mpg123xx/silence.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // Values checked at once; the inner loops have no early exit, so the
+        // compiler vectorizes them.
+        constexpr std::size_t block = 32;
+
+
+        // Note: memcpy keeps unaligned and packed (24-bit) samples legal; it
+        // compiles to plain loads.
+        template<typename T,
+                 typename Loud>
+        std::ptrdiff_t
+        first_of(const std::byte* data,
+                 std::size_t count,
+                 Loud loud)
+            noexcept
+        {
+            T buf[block];
+            std::size_t b = 0;
+            for (; b + block <= count; b += block) {
+                std::memcpy(buf, data + b * sizeof(T), sizeof buf);
+                unsigned any = 0;
+                for (std::size_t k = 0; k < block; ++k)
+                    any |= loud(buf[k]);
+                if (any)
+                    break;
+            }
+            for (std::size_t i = b; i < count; ++i) {
+                T v;
+                std::memcpy(&v, data + i * sizeof(T), sizeof v);
+                if (loud(v))
+                    return i;
+            }
+            return -1;
+        }
+
+
+        template<typename T,
+                 typename Loud>
+        std::ptrdiff_t
+        last_of(const std::byte* data,
+                std::size_t count,
+                Loud loud)
+            noexcept
+        {
+            T buf[block];
+            std::size_t e = count;
+            for (; e >= block; e -= block) {
+                std::memcpy(buf, data + (e - block) * sizeof(T), sizeof buf);
+                unsigned any = 0;
+                for (std::size_t k = 0; k < block; ++k)
+                    any |= loud(buf[k]);
+                if (any)
+                    break;
+            }
+            for (std::size_t i = e; i-- > 0;) {
+                T v;
+                std::memcpy(&v, data + i * sizeof(T), sizeof v);
+                if (loud(v))
+                    return i;
+            }
+            return -1;
+        }
+
+
+        using s24 = std::array<std::uint8_t, 3>;
+
+
+        std::int32_t
+        to_int(const s24& v)
+            noexcept
+        {
+            std::uint32_t u;
+            if constexpr (std::endian::native == std::endian::little)
+                u = v[0] | (v[1] << 8) | (v[2] << 16);
+            else
+                u = v[2] | (v[1] << 8) | (v[0] << 16);
+            // Sign-extend from 24 bits.
+            return static_cast<std::int32_t>(u << 8) >> 8;
+        }
+
+
+        // G.711 expansion to 16-bit linear.
+
+        int
+        ulaw_to_linear(std::uint8_t u)
+            noexcept
+        {
+            u = ~u;
+            int t = ((u & 0x0f) << 3) + 0x84;
+            t <<= (u & 0x70) >> 4;
+            return (u & 0x80) ? 0x84 - t : t - 0x84;
+        }
+
+
+        int
+        alaw_to_linear(std::uint8_t a)
+            noexcept
+        {
+            a ^= 0x55;
+            int t = (a & 0x0f) << 4;
+            int seg = (a & 0x70) >> 4;
+            if (seg == 0)
+                t += 8;
+            else {
+                t += 0x108;
+                if (seg > 1)
+                    t <<= seg - 1;
+            }
+            return (a & 0x80) ? t : -t;
+        }
+
+
+        // Scaled so the largest value of the encoding is 1.0.
+        double
+        full_scale(unsigned encoding)
+        {
+            switch (encoding) {
+                case MPG123_ENC_SIGNED_8:
+                case MPG123_ENC_UNSIGNED_8:
+                    return 127.0;
+                case MPG123_ENC_ULAW_8:
+                case MPG123_ENC_ALAW_8:
+                case MPG123_ENC_SIGNED_16:
+                case MPG123_ENC_UNSIGNED_16:
+                    return 32767.0;
+                case MPG123_ENC_SIGNED_24:
+                case MPG123_ENC_UNSIGNED_24:
+                    return 8388607.0;
+                case MPG123_ENC_SIGNED_32:
+                case MPG123_ENC_UNSIGNED_32:
+                    return 2147483647.0;
+                case MPG123_ENC_FLOAT_32:
+                case MPG123_ENC_FLOAT_64:
+                    return 1.0;
+                default:
+                    throw std::invalid_argument{"silence_detector: unsupported encoding"};
+            }
+        }
+
+
+        // Picks the scan loop and loudness test for the encoding.
+        template<bool Forward>
+        struct scan {
+
+            template<typename T,
+                     typename Loud>
+            static
+            std::ptrdiff_t
+            run(std::span<const std::byte> samples,
+                Loud loud)
+                noexcept
+            {
+                const std::size_t count = samples.size() / sizeof(T);
+                if constexpr (Forward)
+                    return first_of<T>(samples.data(), count, loud);
+                else
+                    return last_of<T>(samples.data(), count, loud);
+            }
+
+
+            static
+            std::ptrdiff_t
+            dispatch(unsigned encoding,
+                     std::span<const std::byte> samples,
+                     double threshold,
+                     std::int64_t t,
+                     const std::array<bool, 256>& loud_byte)
+                noexcept
+            {
+                switch (encoding) {
+                    case MPG123_ENC_SIGNED_16:
+                        return run<std::int16_t>(samples,
+                                                 [t](std::int16_t x) { return x > t || x < -t; });
+                    case MPG123_ENC_UNSIGNED_16:
+                        return run<std::uint16_t>(samples,
+                                                  [t](std::uint16_t x)
+                                                  {
+                                                      int v = x - 0x8000;
+                                                      return v > t || v < -t;
+                                                  });
+                    case MPG123_ENC_SIGNED_24:
+                        return run<s24>(samples,
+                                        [t](const s24& x)
+                                        {
+                                            auto v = to_int(x);
+                                            return v > t || v < -t;
+                                        });
+                    case MPG123_ENC_UNSIGNED_24:
+                        return run<s24>(samples,
+                                        [t](const s24& x)
+                                        {
+                                            // Flipping the top bit turns offset into signed.
+                                            s24 y = x;
+                                            y[std::endian::native == std::endian::little ? 2 : 0] ^= 0x80;
+                                            auto v = to_int(y);
+                                            return v > t || v < -t;
+                                        });
+                    case MPG123_ENC_SIGNED_32:
+                        return run<std::int32_t>(samples,
+                                                 [t](std::int32_t x) { return x > t || x < -t; });
+                    case MPG123_ENC_UNSIGNED_32:
+                        return run<std::uint32_t>(samples,
+                                                  [t](std::uint32_t x)
+                                                  {
+                                                      std::int64_t v = std::int64_t{x} - 0x80000000;
+                                                      return v > t || v < -t;
+                                                  });
+                    case MPG123_ENC_FLOAT_32:
+                        return run<float>(samples,
+                                          [th = float(threshold)](float x)
+                                          {
+                                              return x > th || x < -th;
+                                          });
+                    case MPG123_ENC_FLOAT_64:
+                        return run<double>(samples,
+                                           [threshold](double x)
+                                           {
+                                               return x > threshold || x < -threshold;
+                                           });
+                    default: // 8-bit
+                        return run<std::uint8_t>(samples,
+                                                 [&loud_byte](std::uint8_t x)
+                                                 {
+                                                     return loud_byte[x];
+                                                 });
+                }
+            }
+
+        }; // struct scan
+
+
+        template<typename Fn>
+        bool
+        decode_each(handle& h,
+                    Fn&& fn)
+        {
+            for (;;) {
+                const auto start = h.tell();
+                auto f = h.try_decode_frame();
+                if (!f) {
+                    if (f.error().code == MPG123_NEW_FORMAT)
+                        continue;
+                    if (f.error().code == MPG123_DONE)
+                        return false;
+                    throw f.error();
+                }
+                if (fn(start, *f))
+                    return true;
+            }
+        }
+
+    } // namespace
+
+
+    silence_detector::silence_detector(const format& fmt,
+                                       double threshold_db) :
+        fmt{fmt},
+        bytes_per_sample{sample_size(fmt.encoding)}
+    {
+        const double scale = full_scale(fmt.encoding);
+        const double amplitude = std::pow(10.0, threshold_db / 20.0);
+        threshold = amplitude * scale;
+        int_threshold = static_cast<std::int64_t>(threshold);
+
+        for (int i = 0; i < 256; ++i) {
+            int v = 0;
+            switch (fmt.encoding) {
+                case MPG123_ENC_SIGNED_8:
+                    v = static_cast<std::int8_t>(i);
+                    break;
+                case MPG123_ENC_UNSIGNED_8:
+                    v = i - 128;
+                    break;
+                case MPG123_ENC_ULAW_8:
+                    v = ulaw_to_linear(i);
+                    break;
+                case MPG123_ENC_ALAW_8:
+                    v = alaw_to_linear(i);
+                    break;
+            }
+            loud_byte[i] = std::abs(v) > int_threshold;
+        }
+    }
+
+
+    bool
+    silence_detector::process(std::span<const std::byte> samples,
+                              std::intmax_t input_offset)
+    {
+        const unsigned channels = std::max(fmt.channels, 1u);
+        const std::intmax_t frames = samples.size() / bytes_per_sample / channels;
+        const std::intmax_t start = pos;
+        pos += frames;
+
+        if (!first) {
+            auto i = find_first(samples);
+            if (i < 0)
+                return false;
+            first = stream_position{ start + i / channels, input_offset };
+        }
+        auto j = find_last(samples);
+        if (j < 0)
+            return false;
+        last = stream_position{ start + j / channels, input_offset };
+        return true;
+    }
+
+
+    void
+    silence_detector::set_position(std::intmax_t sample)
+        noexcept
+    {
+        pos = sample;
+    }
+
+
+    std::intmax_t
+    silence_detector::position()
+        const noexcept
+    {
+        return pos;
+    }
+
+
+    const std::optional<stream_position>&
+    silence_detector::first_sound()
+        const noexcept
+    {
+        return first;
+    }
+
+
+    const std::optional<stream_position>&
+    silence_detector::last_sound()
+        const noexcept
+    {
+        return last;
+    }
+
+
+    void
+    silence_detector::reset()
+        noexcept
+    {
+        pos = 0;
+        first.reset();
+        last.reset();
+    }
+
+
+    std::ptrdiff_t
+    silence_detector::find_first(std::span<const std::byte> samples)
+        const noexcept
+    {
+        return scan<true>::dispatch(fmt.encoding, samples, threshold, int_threshold, loud_byte);
+    }
+
+
+    std::ptrdiff_t
+    silence_detector::find_last(std::span<const std::byte> samples)
+        const noexcept
+    {
+        return scan<false>::dispatch(fmt.encoding, samples, threshold, int_threshold, loud_byte);
+    }
+
+
+    silence_bounds
+    find_silence_bounds(handle& h,
+                        double threshold_db,
+                        double tail_seconds)
+    {
+        const format fmt = h.get_format();
+        silence_bounds result{};
+
+        // Leading edge: stop at the first frame with sound.
+        silence_detector head{fmt, threshold_db};
+        decode_each(h,
+                    [&](std::intmax_t start, const frame& f)
+                    {
+                        head.set_position(start);
+                        return head.process(f.samples, h.framepos());
+                    });
+        result.first_sound = head.first_sound();
+        if (!result.first_sound) {
+            result.length = head.position();
+            return result;
+        }
+
+        // Trailing edge.
+        auto total = h.try_length();
+        std::intmax_t window = std::max(tail_seconds, 0.1) * fmt.rate;
+        for (;;) {
+            const std::intmax_t here = h.tell();
+            if (!total || *total - window <= here) {
+                // The tail starts before the current position: just carry on.
+                decode_each(h,
+                            [&](std::intmax_t start, const frame& f)
+                            {
+                                head.set_position(start);
+                                head.process(f.samples, h.framepos());
+                                return false;
+                            });
+                result.last_sound = head.last_sound();
+                result.length = total ? *total : head.position();
+                return result;
+            }
+
+            h.seek(*total - window);
+            silence_detector tail{fmt, threshold_db};
+            decode_each(h,
+                        [&](std::intmax_t start, const frame& f)
+                        {
+                            tail.set_position(start);
+                            tail.process(f.samples, h.framepos());
+                            return false;
+                        });
+            if (tail.last_sound()) {
+                result.last_sound = tail.last_sound();
+                result.length = *total;
+                return result;
+            }
+            // The whole tail was silent; look further back.
+            h.seek(here);
+            window *= 2;
+        }
+    }
+
+} // namespace mpg123
@@ -0,0 +1,310 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "mpg123xx/splicer.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // Header fields that must not change within a stream: sync, version,
+        // layer and sampling rate.
+        constexpr std::uint32_t stream_mask = 0xfffe0c00;
+
+        constexpr std::uint32_t bitrate_mask = 0x0000f000;
+        constexpr std::uint32_t padding_bit = 0x00000200;
+        constexpr std::uint32_t no_crc_bit = 0x00010000;
+
+
+        unsigned
+        version_bits(std::uint32_t header)
+            noexcept
+        {
+            return (header >> 19) & 3; // 3: MPEG 1, 2: MPEG 2, 0: MPEG 2.5
+        }
+
+
+        bool
+        is_layer3(std::uint32_t header)
+            noexcept
+        {
+            return ((header >> 17) & 3) == 1;
+        }
+
+
+        bool
+        is_mono(std::uint32_t header)
+            noexcept
+        {
+            return ((header >> 6) & 3) == 3;
+        }
+
+
+        unsigned
+        sampling_rate(std::uint32_t header)
+            noexcept
+        {
+            static const unsigned rates[3][3] = {
+                { 44100, 48000, 32000 },
+                { 22050, 24000, 16000 },
+                { 11025, 12000,  8000 },
+            };
+            unsigned idx = (header >> 10) & 3;
+            if (idx == 3)
+                return 0;
+            switch (version_bits(header)) {
+                case 3: return rates[0][idx];
+                case 2: return rates[1][idx];
+                case 0: return rates[2][idx];
+                default: return 0;
+            }
+        }
+
+
+        // Layer III frame size, without padding.
+        unsigned
+        layer3_frame_size(std::uint32_t header,
+                          unsigned bitrate_index)
+            noexcept
+        {
+            static const unsigned kbps[2][15] = {
+                { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+                { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160 },
+            };
+            const bool mpeg1 = version_bits(header) == 3;
+            const unsigned rate = sampling_rate(header);
+            if (!rate)
+                return 0;
+            return (mpeg1 ? 144000 : 72000) * kbps[mpeg1 ? 0 : 1][bitrate_index] / rate;
+        }
+
+
+        unsigned
+        side_info_size(std::uint32_t header)
+            noexcept
+        {
+            if (version_bits(header) == 3)
+                return is_mono(header) ? 17 : 32;
+            else
+                return is_mono(header) ? 9 : 17;
+        }
+
+
+        std::byte*
+        put_be32(std::byte* dst,
+                 std::uint32_t value)
+            noexcept
+        {
+            for (int i = 3; i >= 0; --i)
+                *dst++ = std::byte(value >> (8 * i));
+            return dst;
+        }
+
+
+        // An empty Layer III frame holding an Info (CBR) or Xing (VBR) tag.
+        std::vector<std::byte>
+        make_tag_frame(std::uint32_t first_header,
+                       bool vbr,
+                       std::uint64_t total_bytes,
+                       const std::vector<std::uint64_t>& offsets)
+        {
+            const unsigned side = side_info_size(first_header);
+            // header, side info, tag id, flags, frames, bytes, TOC
+            const unsigned needed = 4 + side + 4 + 4 + 4 + 4 + 100;
+
+            unsigned index = 1;
+            while (index < 14 && layer3_frame_size(first_header, index) < needed)
+                ++index;
+            const unsigned frame_size = layer3_frame_size(first_header, index);
+            if (frame_size < needed)
+                throw std::runtime_error{"no Layer III bitrate fits an Info frame"};
+
+            std::uint32_t header = first_header;
+            header &= ~(bitrate_mask | padding_bit);
+            header |= no_crc_bit | (index << 12);
+
+            const std::uint32_t max32 = std::numeric_limits<std::uint32_t>::max();
+            std::vector<std::byte> result(frame_size);
+            std::byte* p = put_be32(result.data(), header);
+            p += side;
+            std::memcpy(p, vbr ? "Xing" : "Info", 4);
+            p += 4;
+            p = put_be32(p, 0x7); // frames, bytes and TOC present
+            p = put_be32(p, std::min<std::uint64_t>(offsets.size(), max32));
+            p = put_be32(p, std::min<std::uint64_t>(total_bytes, max32));
+            for (unsigned i = 0; i < 100; ++i) {
+                std::uint64_t pos = 0;
+                if (!offsets.empty() && total_bytes)
+                    pos = offsets[i * offsets.size() / 100] * 256 / total_bytes;
+                *p++ = std::byte(std::min<std::uint64_t>(pos, 255));
+            }
+            return result;
+        }
+
+    } // namespace
+
+
+    splicer::splicer(const path& filename)
+    {
+        open(filename);
+    }
+
+
+    splicer::~splicer()
+        noexcept
+    {
+        try {
+            close();
+        }
+        catch (...) {}
+    }
+
+
+    void
+    splicer::open(const path& filename)
+    {
+        close();
+        out.exceptions(std::ios::badbit | std::ios::failbit);
+        out.open(filename, std::ios::binary | std::ios::trunc);
+        first_header = 0;
+        tag_size = 0;
+        size = 0;
+        vbr = false;
+        offsets.clear();
+    }
+
+
+    bool
+    splicer::is_open()
+        const noexcept
+    {
+        return out.is_open();
+    }
+
+
+    void
+    splicer::close()
+    {
+        if (!out.is_open())
+            return;
+        try {
+            if (tag_size) {
+                auto tag = make_tag_frame(first_header, vbr, size, offsets);
+                out.seekp(0);
+                out.write(reinterpret_cast<const char*>(tag.data()), tag.size());
+            }
+            out.close();
+        }
+        catch (...) {
+            out.exceptions(std::ios::goodbit);
+            out.close();
+            throw;
+        }
+    }
+
+
+    std::uintmax_t
+    splicer::append(const path& input,
+                    std::intmax_t first,
+                    std::intmax_t last)
+    {
+        handle h;
+        // Gapless decoding may skip leading frames; we want all of them.
+        h.remove_flags(MPG123_GAPLESS);
+        h.open(input);
+        for (std::intmax_t i = 0; i < first; ++i) {
+            auto result = h.try_framebyframe_next();
+            if (!result) {
+                if (result.error().code == MPG123_DONE)
+                    return 0;
+                throw result.error();
+            }
+        }
+        if (last < 0)
+            return append(h, std::numeric_limits<std::uintmax_t>::max());
+        if (last <= first)
+            return 0;
+        return append(h, last - first);
+    }
+
+
+    std::uintmax_t
+    splicer::append(handle& h,
+                    std::uintmax_t count)
+    {
+        std::uintmax_t copied = 0;
+        while (copied < count) {
+            auto result = h.try_framebyframe_next();
+            if (!result) {
+                if (result.error().code == MPG123_DONE)
+                    break;
+                throw result.error();
+            }
+            append(h.get_frame_data());
+            ++copied;
+        }
+        return copied;
+    }
+
+
+    void
+    splicer::append(const raw_frame& f)
+    {
+        if (!first_header) {
+            first_header = f.header;
+            if (is_layer3(f.header)) {
+                // Reserve room for the tag frame; its size only depends on the header.
+                tag_size = make_tag_frame(first_header, false, 0, offsets).size();
+                const std::vector<char> placeholder(tag_size);
+                out.write(placeholder.data(), placeholder.size());
+                size = tag_size;
+            }
+        } else {
+            if ((f.header & stream_mask) != (first_header & stream_mask))
+                throw std::runtime_error{"frame doesn't match the stream's version, "
+                                         "layer or sampling rate"};
+            // Stereo and joint stereo may alternate, but the tag frame's layout
+            // depends on whether the stream is mono.
+            if (is_mono(f.header) != is_mono(first_header))
+                throw std::runtime_error{"can't splice mono and stereo frames"};
+            if ((f.header & bitrate_mask) != (first_header & bitrate_mask))
+                vbr = true;
+        }
+
+        std::byte header[4];
+        put_be32(header, f.header);
+        offsets.push_back(size);
+        out.write(reinterpret_cast<const char*>(header), sizeof header);
+        out.write(reinterpret_cast<const char*>(f.body.data()), f.body.size());
+        size += sizeof header + f.body.size();
+    }
+
+
+    std::uintmax_t
+    splicer::frames()
+        const noexcept
+    {
+        return offsets.size();
+    }
+
+
+    std::uintmax_t
+    splicer::bytes()
+        const noexcept
+    {
+        return size;
+    }
+
+} // namespace mpg123
@@ -0,0 +1,215 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <stdexcept>
+#include <utility>
+
+#include "mpg123xx/stream_decoder.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+
+namespace mpg123 {
+
+    void
+    run_loop::post(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard guard{mutex};
+            queue.push_back(h);
+        }
+        cond.notify_one();
+    }
+
+
+    void
+    run_loop::run()
+    {
+        std::unique_lock guard{mutex};
+        for (;;) {
+            cond.wait(guard, [this] { return stopped || !queue.empty(); });
+            if (stopped)
+                break;
+            auto h = queue.front();
+            queue.pop_front();
+            guard.unlock();
+            h.resume();
+            guard.lock();
+        }
+    }
+
+
+    std::size_t
+    run_loop::run_pending()
+    {
+        std::deque<std::coroutine_handle<>> ready;
+        {
+            std::lock_guard guard{mutex};
+            ready.swap(queue);
+        }
+        // Coroutines posted while these run wait for the next call.
+        for (auto h : ready)
+            h.resume();
+        return ready.size();
+    }
+
+
+    void
+    run_loop::stop()
+    {
+        {
+            std::lock_guard guard{mutex};
+            stopped = true;
+        }
+        cond.notify_all();
+    }
+
+
+    stream_decoder::next_block_awaiter::next_block_awaiter(stream_decoder* decoder)
+        noexcept :
+        decoder{decoder}
+    {}
+
+
+    bool
+    stream_decoder::next_block_awaiter::await_ready()
+    {
+        std::lock_guard guard{decoder->mutex};
+        return decoder->advance(*this);
+    }
+
+
+    bool
+    stream_decoder::next_block_awaiter::await_suspend(std::coroutine_handle<> h)
+    {
+        std::lock_guard guard{decoder->mutex};
+        // Input may have arrived since await_ready().
+        if (decoder->advance(*this))
+            return false;
+        if (decoder->waiting)
+            throw std::logic_error{"stream_decoder: another coroutine is already waiting"};
+        waiter = h;
+        decoder->waiting = this;
+        return true;
+    }
+
+
+    std::span<const std::byte>
+    stream_decoder::next_block_awaiter::await_resume()
+    {
+        if (failure)
+            throw *failure;
+        return pcm;
+    }
+
+
+    stream_decoder::stream_decoder(handle& h,
+                                   executor& ex,
+                                   std::size_t block_size) :
+        h{&h},
+        ex{&ex},
+        block_size{block_size},
+        buf{std::make_unique<std::byte[]>(block_size)}
+    {
+        if (!block_size)
+            throw std::invalid_argument{"stream_decoder: block_size must not be zero"};
+        h.open_feed();
+    }
+
+
+    void
+    stream_decoder::feed(std::span<const std::byte> data)
+    {
+        next_block_awaiter* woken = nullptr;
+        {
+            std::lock_guard guard{mutex};
+            auto result = h->try_feed(data);
+            if (!result)
+                throw result.error();
+            // Decode here, on the producer's side, so the waiter is only resumed
+            // when there's something for it.
+            if (waiting && advance(*waiting))
+                woken = std::exchange(waiting, nullptr);
+        }
+        if (woken)
+            ex->post(woken->waiter);
+    }
+
+
+    void
+    stream_decoder::close()
+    {
+        next_block_awaiter* woken = nullptr;
+        {
+            std::lock_guard guard{mutex};
+            eof = true;
+            if (waiting && advance(*waiting))
+                woken = std::exchange(waiting, nullptr);
+        }
+        if (woken)
+            ex->post(woken->waiter);
+    }
+
+
+    stream_decoder::next_block_awaiter
+    stream_decoder::next_block()
+        noexcept
+    {
+        return next_block_awaiter{this};
+    }
+
+
+    format
+    stream_decoder::get_format()
+    {
+        std::lock_guard guard{mutex};
+        return fmt;
+    }
+
+
+    bool
+    stream_decoder::advance(next_block_awaiter& w)
+    {
+        for (;;) {
+            auto result = h->try_read(buf.get(), block_size);
+            if (result) {
+                if (*result) {
+                    w.pcm = {buf.get(), *result};
+                    break;
+                }
+            } else {
+                const int code = result.error().code;
+                if (code == MPG123_NEW_FORMAT) {
+                    // The handle already reports the new format; keep it for the
+                    // blocks that follow, not the one the consumer may still hold.
+                    auto nf = h->try_get_format();
+                    if (!nf) {
+                        w.failure = nf.error();
+                        break;
+                    }
+                    fmt = *nf;
+                    continue;
+                }
+                if (code == MPG123_DONE) {
+                    w.pcm = {};
+                    break;
+                }
+                if (code != MPG123_NEED_MORE) {
+                    w.failure = result.error();
+                    break;
+                }
+            }
+            // In feed mode the stream only ends when the producer says so.
+            if (!eof)
+                return false;
+            w.pcm = {};
+            break;
+        }
+        return true;
+    }
+
+} // namespace mpg123
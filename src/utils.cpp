@@ -5,6 +5,15 @@
  * SPDX-License-Identifier: LGPL-3.0-or-later
  */
 
+#include <cerrno>
+#include <cstdlib>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "utils.hpp"
 
 
@@ -43,4 +52,70 @@ namespace mpg123::utils {
     }
 
 
+    namespace {
+
+        void
+        write_fully(int fd,
+                    std::span<const std::byte> data)
+        {
+            while (!data.empty()) {
+                ssize_t n = ::write(fd, data.data(), data.size());
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::system_error{errno, std::generic_category(), "write()"};
+                }
+                data = data.subspan(n);
+            }
+        }
+
+
+        void
+        sync_directory(const std::filesystem::path& dir)
+        {
+            int fd = ::open(dir.empty() ? "." : dir.c_str(),
+                            O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+                throw std::system_error{errno, std::generic_category(), "open()"};
+            int e = ::fsync(fd) < 0 ? errno : 0;
+            ::close(fd);
+            if (e)
+                throw std::system_error{e, std::generic_category(), "fsync()"};
+        }
+
+    } // namespace
+
+
+    void
+    replace_file(const std::filesystem::path& filename,
+                 std::initializer_list<std::span<const std::byte>> chunks)
+    {
+        // Unique per call, so threads and processes writing the same file don't
+        // share a temporary.
+        std::string tmp = filename.string() + ".tmp.XXXXXX";
+        int fd = ::mkostemp(tmp.data(), O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), "mkostemp()"};
+        try {
+            // mkostemp() creates it private; make it as readable as a new file.
+            if (::fchmod(fd, 0644) < 0)
+                throw std::system_error{errno, std::generic_category(), "fchmod()"};
+            for (auto chunk : chunks)
+                write_fully(fd, chunk);
+            if (::fsync(fd) < 0)
+                throw std::system_error{errno, std::generic_category(), "fsync()"};
+            if (::close(std::exchange(fd, -1)) < 0)
+                throw std::system_error{errno, std::generic_category(), "close()"};
+            std::filesystem::rename(tmp, filename);
+        }
+        catch (...) {
+            if (fd >= 0)
+                ::close(fd);
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            throw;
+        }
+        sync_directory(filename.parent_path());
+    }
+
 } // mpg123::utils
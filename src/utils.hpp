@@ -8,6 +8,10 @@
 #ifndef MPG123XX_UTILS_HPP
 #define MPG123XX_UTILS_HPP
 
+#include <cstddef>
+#include <filesystem>
+#include <initializer_list>
+#include <span>
 #include <string>
 
 #include <mpg123.h>
@@ -27,6 +31,36 @@ namespace mpg123::utils {
     std::string
     to_string(const mpg123_string& s);
 
+
+    template<typename Alloc>
+    std::basic_string<char, std::char_traits<char>, Alloc>
+    to_string(const mpg123_string* s,
+              const Alloc& alloc)
+    {
+        if (s && s->fill)
+            return {s->p, s->fill - 1, alloc};
+        else
+            return std::basic_string<char, std::char_traits<char>, Alloc>(alloc);
+    }
+
+
+    template<typename Alloc>
+    std::basic_string<char, std::char_traits<char>, Alloc>
+    to_string(const mpg123_string& s,
+              const Alloc& alloc)
+    {
+        return to_string(&s, alloc);
+    }
+
+
+    // Replace filename as a whole, so readers see either the old or the new
+    // content: the chunks go to a uniquely named temporary file next to it,
+    // which is fsynced and renamed over filename. The directory is fsynced too,
+    // so the rename survives a crash.
+    void
+    replace_file(const std::filesystem::path& filename,
+                 std::initializer_list<std::span<const std::byte>> chunks);
+
 } // mpg123::utils
 
 #endif
@@ -0,0 +1,524 @@
+/*
+ * mpg123xx - A C++ wrapper for libmpg123
+ * Copyright 2025  Daniel K. O. (dkosmari)
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mpg123xx/waveform.hpp"
+
+#include "mpg123xx/handle.hpp"
+
+#include "utils.hpp"
+
+
+namespace mpg123 {
+
+    namespace {
+
+        // On-disk layout, in native byte order: a header, a table of levels, then
+        // the buckets of each level, starting at 8-byte boundaries.
+
+        constexpr char waveform_magic[8] = { 'M', 'P', 'G', '1', '2', '3', 'W', 'F' };
+        constexpr std::uint32_t waveform_version = 1;
+
+        constexpr std::uint32_t flag_mono = 1;
+
+
+        struct file_header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t num_levels;
+            std::int64_t rate;
+            std::int64_t length;
+            std::uint32_t flags;
+            std::int32_t down_sample;
+        };
+
+
+        struct level_header {
+            std::uint64_t samples_per_bucket;
+            std::uint64_t count;
+            std::uint64_t offset;
+        };
+
+        static_assert(sizeof(file_header) % 8 == 0);
+        static_assert(sizeof(level_header) % 8 == 0);
+        static_assert(sizeof(waveform_bucket) == 6);
+
+
+        // Unquantized bucket, so coarser levels are built without losing
+        // precision.
+        struct bucket_sum {
+            float min = std::numeric_limits<float>::infinity();
+            float max = -std::numeric_limits<float>::infinity();
+            double sum_sq = 0;
+            std::uint64_t count = 0;
+
+
+            void
+            merge(const bucket_sum& other)
+                noexcept
+            {
+                min = std::min(min, other.min);
+                max = std::max(max, other.max);
+                sum_sq += other.sum_sq;
+                count += other.count;
+            }
+        };
+
+
+        // Note: each lane keeps its own min, max and sum, so the inner loop has no
+        // dependency between iterations and the compiler vectorizes it.
+        constexpr std::size_t lanes = 8;
+
+        void
+        reduce(const float* x,
+               std::size_t n,
+               bucket_sum& acc)
+            noexcept
+        {
+            float lo[lanes];
+            float hi[lanes];
+            float sq[lanes];
+            for (std::size_t k = 0; k < lanes; ++k) {
+                lo[k] = acc.min;
+                hi[k] = acc.max;
+                sq[k] = 0;
+            }
+            std::size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+                for (std::size_t k = 0; k < lanes; ++k) {
+                    const float v = x[i + k];
+                    lo[k] = v < lo[k] ? v : lo[k];
+                    hi[k] = v > hi[k] ? v : hi[k];
+                    sq[k] += v * v;
+                }
+            for (std::size_t k = 0; i < n; ++i, ++k) {
+                const float v = x[i];
+                lo[k] = v < lo[k] ? v : lo[k];
+                hi[k] = v > hi[k] ? v : hi[k];
+                sq[k] += v * v;
+            }
+            for (std::size_t k = 0; k < lanes; ++k) {
+                acc.min = std::min(acc.min, lo[k]);
+                acc.max = std::max(acc.max, hi[k]);
+                acc.sum_sq += sq[k];
+            }
+            acc.count += n;
+        }
+
+
+        std::int16_t
+        quantize(double v)
+            noexcept
+        {
+            return std::clamp<long>(std::lround(v * 32767.0), -32768, 32767);
+        }
+
+
+        waveform_bucket
+        finish(const bucket_sum& s)
+            noexcept
+        {
+            if (!s.count)
+                return {};
+            return {
+                quantize(s.min),
+                quantize(s.max),
+                quantize(std::sqrt(s.sum_sq / s.count))
+            };
+        }
+
+
+        handle
+        open_for_waveform(const path& filename,
+                          const waveform_options& opts,
+                          const seek_policy& policy)
+        {
+            handle h;
+            h.add_flags(MPG123_FORCE_FLOAT);
+            if (opts.mono)
+                h.add_flags(MPG123_MONO_MIX);
+            h.set_down_sample(opts.down_sample);
+            h.set_seek_policy(policy);
+            h.open(filename);
+            if (policy.prescan)
+                h.scan();
+            return h;
+        }
+
+
+        // Decode from the current position into buckets of bucket_size samples,
+        // until limit samples were consumed (or the end of the stream). A partial
+        // bucket at the end is kept.
+        std::vector<bucket_sum>
+        decode_buckets(handle& h,
+                       std::uint64_t bucket_size,
+                       std::uint64_t limit)
+        {
+            std::vector<bucket_sum> result;
+            bucket_sum current;
+            std::uint64_t in_bucket = 0; // values
+            std::uint64_t consumed = 0;  // samples per channel
+            unsigned channels = 0;
+            std::uint64_t bucket_values = 0;
+
+            while (consumed < limit) {
+                auto f = h.try_decode_frame();
+                if (!f) {
+                    if (f.error().code == MPG123_NEW_FORMAT)
+                        continue;
+                    if (f.error().code == MPG123_DONE)
+                        break;
+                    throw f.error();
+                }
+                if (!channels) {
+                    channels = std::max(h.get_format().channels, 1u);
+                    bucket_values = bucket_size * channels;
+                }
+
+                auto values = reinterpret_cast<const float*>(f->samples.data());
+                std::uint64_t count = f->samples.size() / sizeof(float);
+                if (count / channels > limit - consumed)
+                    count = (limit - consumed) * channels;
+                consumed += count / channels;
+
+                while (count) {
+                    const auto n = std::min(count, bucket_values - in_bucket);
+                    reduce(values, n, current);
+                    values += n;
+                    count -= n;
+                    in_bucket += n;
+                    if (in_bucket == bucket_values) {
+                        result.push_back(current);
+                        current = {};
+                        in_bucket = 0;
+                    }
+                }
+            }
+            if (in_bucket)
+                result.push_back(current);
+            return result;
+        }
+
+    } // namespace
+
+
+    waveform::waveform(const path& filename)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), "open()"};
+        struct ::stat st;
+        if (::fstat(fd, &st) < 0) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error{e, std::generic_category(), "fstat()"};
+        }
+        const std::size_t file_size = st.st_size;
+        if (file_size < sizeof(file_header)) {
+            ::close(fd);
+            throw std::runtime_error{"waveform file is too small"};
+        }
+        void* addr = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throw std::system_error{errno, std::generic_category(), "mmap()"};
+        base = static_cast<const std::byte*>(addr);
+        size = file_size;
+        mapped = true;
+
+        file_header header;
+        std::memcpy(&header, base, sizeof header);
+        bool valid = !std::memcmp(header.magic, waveform_magic, sizeof waveform_magic)
+            && header.version == waveform_version
+            && header.num_levels <= (size - sizeof header) / sizeof(level_header);
+        for (unsigned i = 0; valid && i < header.num_levels; ++i) {
+            level_header lh;
+            std::memcpy(&lh, base + sizeof header + i * sizeof lh, sizeof lh);
+            valid = lh.offset % 8 == 0
+                && lh.offset <= size
+                && lh.count <= (size - lh.offset) / sizeof(waveform_bucket);
+        }
+        if (!valid) {
+            close();
+            throw std::runtime_error{"not a valid waveform file"};
+        }
+    }
+
+
+    waveform::waveform(waveform&& other)
+        noexcept :
+        owned{std::move(other.owned)},
+        base{std::exchange(other.base, nullptr)},
+        size{std::exchange(other.size, 0)},
+        mapped{std::exchange(other.mapped, false)}
+    {}
+
+
+    waveform&
+    waveform::operator =(waveform&& other)
+        noexcept
+    {
+        if (this != &other) {
+            close();
+            owned = std::move(other.owned);
+            base = std::exchange(other.base, nullptr);
+            size = std::exchange(other.size, 0);
+            mapped = std::exchange(other.mapped, false);
+        }
+        return *this;
+    }
+
+
+    waveform::~waveform()
+        noexcept
+    {
+        close();
+    }
+
+
+    void
+    waveform::close()
+        noexcept
+    {
+        if (mapped)
+            ::munmap(const_cast<std::byte*>(base), size);
+        owned.clear();
+        base = nullptr;
+        size = 0;
+        mapped = false;
+    }
+
+
+    waveform
+    waveform::generate(const path& filename,
+                       const waveform_options& opts)
+    {
+        if (!opts.samples_per_bucket || !opts.levels || opts.zoom_factor < 2)
+            throw std::invalid_argument{"invalid waveform options"};
+        if (opts.down_sample < 0 || opts.down_sample > 2)
+            throw std::invalid_argument{"waveform down_sample must be 0, 1 or 2"};
+
+        // Decoded samples per bucket; the buckets cover the same time in every
+        // mode.
+        const std::uint64_t bucket_size = std::max<std::uint64_t>(opts.samples_per_bucket >> opts.down_sample,
+                                                                  1);
+        unsigned threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+        threads = std::max(threads, 1u);
+
+        handle h = open_for_waveform(filename,
+                                     opts,
+                                     threads > 1 ? seek_policy::prescanned() : seek_policy::defaults());
+        const format fmt = h.get_format();
+
+        std::vector<bucket_sum> sums;
+        std::intmax_t decoded_length = -1;
+        if (threads > 1) {
+            auto length = h.try_length();
+            auto index = h.try_get_seek_index();
+            if (length && *length > 0 && index && !index->offsets.empty()) {
+                decoded_length = *length;
+                const std::uint64_t total = (*length + bucket_size - 1) / bucket_size;
+                threads = std::min<std::uint64_t>(threads, total);
+            } else
+                threads = 1;
+        }
+
+        if (threads > 1) {
+            // Each worker gets a contiguous run of buckets; the first one reuses
+            // the handle, which is already at the start.
+            const std::uint64_t total = (decoded_length + bucket_size - 1) / bucket_size;
+            const std::vector<off_t> offsets(h.get_seek_index().offsets.begin(),
+                                             h.get_seek_index().offsets.end());
+            const seek_index shared{ .offsets = offsets, .step = h.get_seek_index().step };
+
+            std::vector<std::vector<bucket_sum>> parts(threads);
+            std::vector<std::exception_ptr> errors(threads);
+            auto range = [&](unsigned i)
+            {
+                return std::pair{ total * i / threads, total * (i + 1) / threads };
+            };
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(threads - 1);
+                for (unsigned i = 1; i < threads; ++i)
+                    workers.emplace_back([&, i]
+                    {
+                        try {
+                            auto [first, last] = range(i);
+                            handle wh = open_for_waveform(filename, opts, seek_policy::growing());
+                            wh.set_seek_index(shared);
+                            wh.seek(first * bucket_size);
+                            parts[i] = decode_buckets(wh, bucket_size, (last - first) * bucket_size);
+                        }
+                        catch (...) {
+                            errors[i] = std::current_exception();
+                        }
+                    });
+                try {
+                    auto [first, last] = range(0);
+                    parts[0] = decode_buckets(h, bucket_size, (last - first) * bucket_size);
+                }
+                catch (...) {
+                    errors[0] = std::current_exception();
+                }
+            }
+            for (auto& e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+            sums.reserve(total);
+            for (auto& p : parts)
+                sums.insert(sums.end(), p.begin(), p.end());
+        } else {
+            sums = decode_buckets(h, bucket_size, std::numeric_limits<std::uint64_t>::max());
+            decoded_length = h.tell();
+        }
+
+        // Build the coarser levels from the unquantized sums.
+        std::vector<std::vector<bucket_sum>> levels;
+        levels.push_back(std::move(sums));
+        for (unsigned l = 1; l < opts.levels; ++l) {
+            const auto& prev = levels.back();
+            std::vector<bucket_sum> next((prev.size() + opts.zoom_factor - 1) / opts.zoom_factor);
+            for (std::size_t i = 0; i < prev.size(); ++i)
+                next[i / opts.zoom_factor].merge(prev[i]);
+            levels.push_back(std::move(next));
+        }
+
+        file_header header{};
+        std::memcpy(header.magic, waveform_magic, sizeof waveform_magic);
+        header.version = waveform_version;
+        header.num_levels = levels.size();
+        header.rate = fmt.rate << opts.down_sample;
+        header.length = decoded_length << opts.down_sample;
+        header.flags = opts.mono ? flag_mono : 0;
+        header.down_sample = opts.down_sample;
+
+        std::vector<level_header> table(levels.size());
+        std::uint64_t offset = sizeof header + table.size() * sizeof(level_header);
+        std::uint64_t spb = opts.samples_per_bucket;
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            table[l] = { .samples_per_bucket = spb, .count = levels[l].size(), .offset = offset };
+            offset += levels[l].size() * sizeof(waveform_bucket);
+            offset = (offset + 7) & ~std::uint64_t{7};
+            spb *= opts.zoom_factor;
+        }
+
+        waveform result;
+        result.owned.resize(offset);
+        std::byte* out = result.owned.data();
+        std::memcpy(out, &header, sizeof header);
+        std::memcpy(out + sizeof header, table.data(), table.size() * sizeof(level_header));
+        for (std::size_t l = 0; l < levels.size(); ++l) {
+            auto dst = out + table[l].offset;
+            for (auto& s : levels[l]) {
+                const auto b = finish(s);
+                std::memcpy(dst, &b, sizeof b);
+                dst += sizeof b;
+            }
+        }
+        result.base = result.owned.data();
+        result.size = result.owned.size();
+        return result;
+    }
+
+
+    void
+    waveform::save(const path& filename)
+        const
+    {
+        utils::replace_file(filename, {std::span<const std::byte>{base, size}});
+    }
+
+
+    namespace {
+
+        file_header
+        header_of(const std::byte* base)
+            noexcept
+        {
+            file_header header{};
+            if (base)
+                std::memcpy(&header, base, sizeof header);
+            return header;
+        }
+
+    } // namespace
+
+
+    long
+    waveform::rate()
+        const noexcept
+    {
+        return header_of(base).rate;
+    }
+
+
+    std::intmax_t
+    waveform::length()
+        const noexcept
+    {
+        return header_of(base).length;
+    }
+
+
+    bool
+    waveform::is_preview()
+        const noexcept
+    {
+        auto header = header_of(base);
+        return (header.flags & flag_mono) || header.down_sample;
+    }
+
+
+    unsigned
+    waveform::num_levels()
+        const noexcept
+    {
+        return header_of(base).num_levels;
+    }
+
+
+    waveform_level
+    waveform::level(unsigned index)
+        const
+    {
+        if (index >= num_levels())
+            throw std::out_of_range{"waveform level " + std::to_string(index)};
+        level_header lh;
+        std::memcpy(&lh, base + sizeof(file_header) + index * sizeof lh, sizeof lh);
+        return {
+            .samples_per_bucket = lh.samples_per_bucket,
+            .buckets = std::span(reinterpret_cast<const waveform_bucket*>(base + lh.offset),
+                                 lh.count)
+        };
+    }
+
+
+    std::span<const std::byte>
+    waveform::data()
+        const noexcept
+    {
+        return { base, size };
+    }
+
+} // namespace mpg123